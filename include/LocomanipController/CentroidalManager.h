@@ -1,6 +1,11 @@
 #pragma once
 
+#include <vector>
+
 #include <BaselineWalkingController/CentroidalManager.h>
+#include <LocomanipController/HandTypes.h>
+#include <LocomanipController/LogDecimator.h>
+#include <LocomanipController/ManipManager.h>
 
 namespace LMC
 {
@@ -13,6 +18,158 @@ class LocomanipController;
  */
 class CentroidalManager : virtual public BWC::CentroidalManager
 {
+public:
+  /** \brief Data of ext-ZMP (i.e., ZMP with external forces).
+
+
+      The definition of ext-ZMP is given in the equation (9) of the paper:
+        M Murooka, et al. Humanoid loco-Manipulations pattern generation and stabilization control. RA-Letters, 2021
+  */
+  struct ExtZmpData
+  {
+    //! Scale
+    double scale = 1.0;
+
+    //! Offset
+    Eigen::Vector2d offset = Eigen::Vector2d::Zero();
+
+    /** \brief Convert conventional ZMP to ext-ZMP.
+        \param zmp ZMP
+     */
+    inline Eigen::Vector2d apply(const Eigen::Vector2d & zmp) const
+    {
+      return scale * zmp - offset;
+    }
+
+    /** \brief Convert ext-ZMP to conventional ZMP.
+        \param extZmp ext-ZMP
+     */
+    inline Eigen::Vector2d applyInv(const Eigen::Vector2d & extZmp) const
+    {
+      return (extZmp + offset) / scale;
+    }
+  };
+
+  /** \brief Sequence of ext-ZMP data over the preview horizon.
+
+      The data are stored in the structure-of-arrays layout so that the ext-ZMP terms of all the samples are
+      accumulated with array operations. The reference interpolators are still evaluated sample by sample.
+  */
+  struct ExtZmpDataSeq
+  {
+    /** \brief Sequence of hand position and wrench represented in the world frame. */
+    struct HandWrenchSeq
+    {
+      //! Hand position
+      //! @{
+      Eigen::ArrayXd posX;
+      Eigen::ArrayXd posY;
+      Eigen::ArrayXd posZ;
+      //! @}
+
+      //! Hand force
+      //! @{
+      Eigen::ArrayXd forceX;
+      Eigen::ArrayXd forceY;
+      Eigen::ArrayXd forceZ;
+      //! @}
+
+      //! Hand moment (z element is not used)
+      //! @{
+      Eigen::ArrayXd momentX;
+      Eigen::ArrayXd momentY;
+      //! @}
+
+      /** \brief Resize.
+          \param size sequence size
+       */
+      void resize(Eigen::Index size);
+    };
+
+    //! Time of the first sample [sec]
+    double startTime = 0.0;
+
+    //! Time step between samples [sec]
+    double dt = 0.0;
+
+    //! Reference ZMP
+    //! @{
+    Eigen::ArrayXd refZmpX;
+    Eigen::ArrayXd refZmpY;
+    Eigen::ArrayXd refZmpZ;
+    //! @}
+
+    //! Scale of ext-ZMP
+    Eigen::ArrayXd scale;
+
+    //! Offset of ext-ZMP
+    //! @{
+    Eigen::ArrayXd offsetX;
+    Eigen::ArrayXd offsetY;
+    //! @}
+
+    //! Sequences of hand position and wrench (used as work buffers)
+    EnumArray<Hand, HandWrenchSeq> handWrenchSeqs = {{Hand::Left, HandWrenchSeq()},
+                                                     {Hand::Right, HandWrenchSeq()}};
+
+    /** \brief Get sequence size. */
+    inline Eigen::Index size() const
+    {
+      return scale.size();
+    }
+
+    /** \brief Resize (memory is reallocated only when the size changes).
+        \param size sequence size
+     */
+    void resize(Eigen::Index size);
+
+    /** \brief Get index of the sample at the specified time.
+        \param t time [sec]
+        \return index of the sample, or -1 if the time does not match any sample
+
+        The time matches a sample if it is within 1e-6 of the time step from the sample time.
+     */
+    Eigen::Index index(double t) const;
+
+    /** \brief Get ext-ZMP data of the specified sample.
+        \param idx index of the sample
+     */
+    ExtZmpData extZmpData(Eigen::Index idx) const;
+
+    /** \brief Interpolate ext-ZMP data and reference ZMP linearly between samples.
+        \param t time [sec] (clamped to the range of the sequence)
+        \param extZmpData interpolated ext-ZMP data
+        \param refZmp interpolated reference ZMP
+
+        The sequence must not be empty.
+     */
+    void interpolate(double t, ExtZmpData & extZmpData, Eigen::Vector3d & refZmp) const;
+  };
+
+  /** \brief Copy of the reference data to calculate the sequence of ext-ZMP data.
+
+      This is used to calculate the sequence in another thread without accessing FootManager and ManipManager, whose
+      reference functions are rebuilt in place by the control thread.
+  */
+  struct ExtZmpRefData
+  {
+    //! Times of the knots of the reference ZMP [sec] (the current time, footstep switching times, and horizon end)
+    std::vector<double> refZmpKnotTimes;
+
+    //! Reference ZMP at the knots
+    std::vector<Eigen::Vector3d> refZmpKnots;
+
+    //! Copy of the reference functions of ManipManager
+    ManipManager::RefFuncSnapshot manipRefFuncs;
+
+    /** \brief Calculate reference ZMP.
+        \param t time [sec]
+
+        The reference ZMP is interpolated linearly between the knots in the same way as FootManager.
+    */
+    Eigen::Vector3d calcRefZmp(double t) const;
+  };
+
 public:
   /** \brief Constructor.
       \param ctlPtr pointer to controller
@@ -20,11 +177,87 @@ public:
    */
   CentroidalManager(LocomanipController * ctlPtr, const mc_rtc::Configuration & mcRtcConfig = {});
 
+  /** \brief Const accessor to the sequence of ext-ZMP data over the MPC horizon in the current control cycle. */
+  inline const ExtZmpDataSeq & extZmpDataSeq() const noexcept
+  {
+    return extZmpDataSeq_;
+  }
+
 protected:
   /** \brief Const accessor to the controller. */
   const LocomanipController & ctl() const;
 
   /** \brief Accessor to the controller. */
   LocomanipController & ctl();
+
+  /** \brief Calculate data of ext-ZMP. */
+  ExtZmpData calcExtZmpData(double t) const;
+
+  /** \brief Calculate sequence of ext-ZMP data in one pass.
+      \param startTime time of the first sample [sec]
+      \param dt time step between samples [sec]
+      \param size number of samples
+      \param extZmpDataSeq sequence of ext-ZMP data to be filled
+
+      This gives the same results as calling calcExtZmpData for each sample time. The reference ZMP and the object
+      pose are evaluated once per sample and shared by both hands, instead of once per hand as in calcExtZmpData.
+      Only the accumulation of the ext-ZMP terms is done with array operations over the samples. The interpolators
+      of the reference ZMP, object pose, and hand wrench are not batched and are evaluated sample by sample.
+   */
+  void calcExtZmpDataSeq(double startTime, double dt, Eigen::Index size, ExtZmpDataSeq & extZmpDataSeq) const;
+
+  /** \brief Calculate sequence of ext-ZMP data from the copy of the reference data.
+      \param refData copy of the reference data (refData.manipRefFuncs.build() must be called in advance)
+      \param startTime time of the first sample [sec]
+      \param dt time step between samples [sec]
+      \param size number of samples
+      \param extZmpDataSeq sequence of ext-ZMP data to be filled
+
+      This does not access the controller and can be called in a thread other than the control thread.
+   */
+  void calcExtZmpDataSeq(const ExtZmpRefData & refData,
+                         double startTime,
+                         double dt,
+                         Eigen::Index size,
+                         ExtZmpDataSeq & extZmpDataSeq) const;
+
+  /** \brief Copy the reference data to calculate the sequence of ext-ZMP data.
+      \param startTime start time of the sequence [sec]
+      \param endTime end time of the sequence [sec]
+      \param refData copy of the reference data
+
+      The reference ZMP is copied only at the footstep switching times, so the cost does not depend on the number of
+      samples in the sequence.
+   */
+  void copyExtZmpRefData(double startTime, double endTime, ExtZmpRefData & refData) const;
+
+  /** \brief Reset the decimator of logged ext-ZMP data. */
+  void resetExtZmpLog();
+
+  /** \brief Write ext-ZMP data to the separate log file in the sampling cycles.
+
+      This method should be called once every control cycle after extZmpData_ is updated.
+  */
+  void updateExtZmpLog();
+
+  /** \brief Add ext-ZMP entries to the logger.
+      \param logger logger
+      \param name prefix of entry names
+  */
+  void addExtZmpToLogger(mc_rtc::Logger & logger, const std::string & name);
+
+protected:
+  //! Data of ext-ZMP
+  ExtZmpData extZmpData_;
+
+  //! Sequence of ext-ZMP data over the MPC horizon
+  ExtZmpDataSeq extZmpDataSeq_;
+
+  //! Number of control cycles between samples of logged ext-ZMP data, which is written to a separate log file if
+  //! greater than 1
+  int extZmpLogDecimation_ = 1;
+
+  //! Decimator of logged ext-ZMP data
+  LogDecimator extZmpLogDecimator_;
 };
 } // namespace LMC
@@ -1,6 +1,10 @@
 #pragma once
 
-#include <set>
+#include <array>
+#include <cstddef>
+#include <initializer_list>
+#include <string>
+#include <utility>
 
 namespace LMC
 {
@@ -17,9 +21,111 @@ enum class Hand
 namespace Hands
 {
 //! Both hands
-const std::set<Hand> Both = {Hand::Left, Hand::Right};
+constexpr std::array<Hand, 2> Both = {Hand::Left, Hand::Right};
 } // namespace Hands
 
+/** \brief Number of enumerators.
+    \tparam EnumType enum type
+*/
+template<class EnumType>
+struct EnumSize;
+
+/** \brief Number of hands. */
+template<>
+struct EnumSize<Hand>
+{
+  static constexpr size_t value = 2;
+};
+
+/** \brief Fixed-size array indexed by enumerators.
+    \tparam EnumType enum type whose enumerators are consecutive integers starting from zero
+    \tparam T value type
+
+    This is used in place of std::unordered_map for per-hand data so that lookups require neither hashing nor pointer
+    chasing.
+*/
+template<class EnumType, class T>
+class EnumArray
+{
+public:
+  //! Number of elements
+  static constexpr size_t Size = EnumSize<EnumType>::value;
+
+public:
+  /** \brief Constructor. */
+  EnumArray() = default;
+
+  /** \brief Constructor.
+      \param values values ordered by enumerators
+  */
+  explicit EnumArray(const std::array<T, Size> & values) : values_(values) {}
+
+  /** \brief Constructor.
+      \param keyValues pairs of enumerator and value
+  */
+  EnumArray(std::initializer_list<std::pair<EnumType, T>> keyValues)
+  {
+    for(const auto & keyValue : keyValues)
+    {
+      at(keyValue.first) = keyValue.second;
+    }
+  }
+
+  /** \brief Accessor to the element. */
+  inline T & at(const EnumType & key)
+  {
+    return values_[static_cast<size_t>(key)];
+  }
+
+  /** \brief Const accessor to the element. */
+  inline const T & at(const EnumType & key) const
+  {
+    return values_[static_cast<size_t>(key)];
+  }
+
+  /** \brief Accessor to the element. */
+  inline T & operator[](const EnumType & key)
+  {
+    return at(key);
+  }
+
+  /** \brief Const accessor to the element. */
+  inline const T & operator[](const EnumType & key) const
+  {
+    return at(key);
+  }
+
+  /** \brief Get number of elements. */
+  inline constexpr size_t size() const
+  {
+    return Size;
+  }
+
+  /** \brief Iterators over the values. */
+  //! @{
+  inline typename std::array<T, Size>::iterator begin()
+  {
+    return values_.begin();
+  }
+  inline typename std::array<T, Size>::iterator end()
+  {
+    return values_.end();
+  }
+  inline typename std::array<T, Size>::const_iterator begin() const
+  {
+    return values_.begin();
+  }
+  inline typename std::array<T, Size>::const_iterator end() const
+  {
+    return values_.end();
+  }
+  //! @}
+
+protected:
+  //! Values ordered by enumerators
+  std::array<T, Size> values_ = {};
+};
+
 /** \brief Convert string to hand. */
 Hand strToHand(const std::string & handStr);
 
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <type_traits>
+
+namespace LMC
+{
+/** \brief Lock-free buffer to pass the latest value from a single producer thread to a single consumer thread.
+    \tparam T value type (must be trivially copyable)
+
+    This is a triple buffer: the producer and the consumer each own one slot, and the remaining slot is exchanged
+    atomically. Neither write() nor read() blocks or allocates memory, and the consumer always gets the latest value
+    written by the producer (intermediate values may be skipped).
+*/
+template<class T>
+class LatestValueBuffer
+{
+  static_assert(std::is_trivially_copyable<T>::value, "LatestValueBuffer requires a trivially copyable type.");
+
+public:
+  /** \brief Write value (called only from the producer thread).
+      \param value value to write
+  */
+  void write(const T & value)
+  {
+    buffers_[writeIdx_] = value;
+    uint8_t prevState = state_.exchange(static_cast<uint8_t>(writeIdx_ | newDataFlag_), std::memory_order_acq_rel);
+    writeIdx_ = prevState & idxMask_;
+  }
+
+  /** \brief Read the latest value (called only from the consumer thread).
+      \param value value to be overwritten by the latest one
+      \return whether a new value has been written since the last read
+  */
+  bool read(T & value)
+  {
+    if(!(state_.load(std::memory_order_relaxed) & newDataFlag_))
+    {
+      return false;
+    }
+    uint8_t prevState = state_.exchange(readIdx_, std::memory_order_acq_rel);
+    readIdx_ = prevState & idxMask_;
+    value = buffers_[readIdx_];
+    return true;
+  }
+
+protected:
+  //! Mask of slot index in state
+  static constexpr uint8_t idxMask_ = 0x3;
+
+  //! Flag of state representing that the exchanged slot has a new value
+  static constexpr uint8_t newDataFlag_ = 0x4;
+
+  //! Slots
+  std::array<T, 3> buffers_ = {};
+
+  //! Index of the slot owned by the producer
+  uint8_t writeIdx_ = 0;
+
+  //! Index of the exchanged slot and the flag of new value
+  std::atomic<uint8_t> state_{1};
+
+  //! Index of the slot owned by the consumer
+  uint8_t readIdx_ = 2;
+};
+} // namespace LMC
@@ -3,6 +3,8 @@
 #include <BaselineWalkingController/BaselineWalkingController.h>
 
 #include <LocomanipController/HandTypes.h>
+#include <LocomanipController/TimingHistogram.h>
+#include <LocomanipController/TraceRecorder.h>
 
 namespace mc_tasks
 {
@@ -15,10 +17,31 @@ struct ImpedanceTask;
 namespace LMC
 {
 class ManipManager;
+class PlanPublisher;
 
 /** \brief Humanoid loco-manipulation controller. */
 struct LocomanipController : public BWC::BaselineWalkingController
 {
+public:
+  /** \brief Histograms of computation time in run(). */
+  struct RunTimings
+  {
+    //! Update of foot manager
+    TimingHistogram footManager;
+
+    //! Update of manipulation manager
+    TimingHistogram manipManager;
+
+    //! Update of centroidal manager
+    TimingHistogram centroidalManager;
+
+    //! Run of FSM and QP
+    TimingHistogram fsm;
+
+    //! Whole run()
+    TimingHistogram total;
+  };
+
 public:
   /** \brief Constructor.
       \param rm robot module
@@ -49,6 +72,18 @@ public:
    */
   void stop() override;
 
+  /** \brief Clear the histograms of computation time in run().
+
+      The deadline of all the histograms is the control timestep.
+   */
+  void resetRunTimings();
+
+  /** \brief Const accessor to the histograms of computation time in run(). */
+  inline const RunTimings & runTimings() const noexcept
+  {
+    return runTimings_;
+  }
+
   /** \brief Accessor to the control object. */
   inline mc_rbdyn::Robot & obj()
   {
@@ -75,9 +110,19 @@ public:
 
 public:
   //! Hand tasks
-  std::unordered_map<Hand, std::shared_ptr<mc_tasks::force::ImpedanceTask>> handTasks_;
+  EnumArray<Hand, std::shared_ptr<mc_tasks::force::ImpedanceTask>> handTasks_;
 
   //! Manipulation manager
   std::shared_ptr<ManipManager> manipManager_;
+
+  //! Plan publisher (nullptr if not configured)
+  std::shared_ptr<PlanPublisher> planPublisher_;
+
+protected:
+  //! Histograms of computation time in run()
+  RunTimings runTimings_;
+
+  //! Configuration of trace recorder
+  TraceRecorder::Configuration traceRecorderConfig_;
 };
 } // namespace LMC
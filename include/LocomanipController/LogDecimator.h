@@ -0,0 +1,81 @@
+#pragma once
+
+#include <memory>
+#include <string>
+
+#include <mc_rtc/log/Logger.h>
+
+namespace LMC
+{
+/** \brief Logger of a group of heavy entries at a lower rate.
+
+    If the decimation is greater than 1, the entries in a group are written to a separate log file once every specified
+    number of control cycles, so that both the sampling cost and the size of the main log are reduced. The separate log
+    file is placed next to the main log file with the group name appended (e.g.,
+    mc-control-LocomanipController-<date>-ManipManager_objState.bin), and its time is the controller time. If the
+    decimation is 1, the entries are written to the main log every control cycle.
+*/
+class LogDecimator
+{
+public:
+  /** \brief Reset.
+      \param name group name appended to the name of the separate log file
+      \param decimation number of control cycles between samples (1 for no decimation)
+      \param dt control timestep [sec]
+
+      This method should be called before the entries are added. The separate log file of the previous reset is closed.
+  */
+  void reset(const std::string & name, int decimation, double dt);
+
+  /** \brief Get the logger to which the entries of the group are added.
+      \param mainLogger main logger of the controller
+
+      The main logger is returned if the decimation is 1, and the logger of the separate log file is returned otherwise.
+  */
+  mc_rtc::Logger & logger(mc_rtc::Logger & mainLogger);
+
+  /** \brief Update the counter and write the entries to the separate log file in the sampling cycles.
+      \param t controller time [sec]
+      \return whether the entries are sampled in the current control cycle
+
+      This method should be called once every control cycle. The separate log file is opened in the first sampling
+      cycle after the main log file is opened.
+  */
+  bool update(double t);
+
+  /** \brief Get number of control cycles between samples. */
+  inline int decimation() const noexcept
+  {
+    return decimation_;
+  }
+
+protected:
+  /** \brief Open the separate log file next to the main log file.
+      \param t controller time [sec]
+      \return whether the file is opened
+  */
+  bool open(double t);
+
+protected:
+  //! Group name
+  std::string name_;
+
+  //! Number of control cycles between samples
+  int decimation_ = 1;
+
+  //! Control timestep [sec]
+  double dt_ = 0.0;
+
+  //! Number of control cycles since the last sample
+  int count_ = 0;
+
+  //! Main logger of the controller (used to get the path of the main log file)
+  mc_rtc::Logger * mainLogger_ = nullptr;
+
+  //! Logger of the separate log file (nullptr if the decimation is 1)
+  std::unique_ptr<mc_rtc::Logger> logger_;
+
+  //! Whether the separate log file is opened
+  bool opened_ = false;
+};
+} // namespace LMC
@@ -1,6 +1,14 @@
 #pragma once
 
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
 #include <deque>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <type_traits>
 #include <unordered_map>
 
 #include <mc_rtc/constants.h>
@@ -18,19 +26,33 @@
 
 #include <LocomanipController/FootTypes.h>
 #include <LocomanipController/HandTypes.h>
+#include <LocomanipController/LatestValueBuffer.h>
+#include <LocomanipController/LogDecimator.h>
+#include <LocomanipController/ManipPhase.h>
+#include <LocomanipController/StampedPoseHistory.h>
+#include <LocomanipController/TimingHistogram.h>
 
 namespace LMC
 {
 class LocomanipController;
 
-namespace ManipPhase
-{
-class Base;
-}
-
 /** \brief Waypoint of object trajectory. */
 struct Waypoint
 {
+  /** \brief Waypoint options.
+
+      Options are parsed from the configuration when the waypoint is constructed so that the trajectory update does not
+      look up the configuration every control cycle.
+  */
+  struct Options
+  {
+    //! Acceleration duration of bang-bang interpolation [sec]
+    double accelDuration = 0.0;
+
+    /** \brief Load mc_rtc configuration. */
+    void load(const mc_rtc::Configuration & mcRtcConfig);
+  };
+
   /** \brief Constructor.
       \param _startTime start time [sec]
       \param _endTime end time [sec]
@@ -41,7 +63,14 @@ struct Waypoint
            double _endTime,
            const sva::PTransformd & _pose,
            const mc_rtc::Configuration & _config = {})
-  : startTime(_startTime), endTime(_endTime), pose(_pose), config(_config){};
+  : startTime(_startTime), endTime(_endTime), pose(_pose)
+  {
+    if(!_config.empty())
+    {
+      options.load(_config);
+      config = _config;
+    }
+  }
 
   //! Start time [sec]
   double startTime;
@@ -52,10 +81,15 @@ struct Waypoint
   //! Object pose
   sva::PTransformd pose;
 
-  //! Additional configuration
-  mc_rtc::Configuration config;
+  //! Options
+  Options options;
+
+  //! Additional configuration (only set if it is given to the constructor)
+  std::optional<mc_rtc::Configuration> config;
 };
 
+static_assert(std::is_trivially_copyable<Waypoint::Options>::value, "Waypoint::Options must be trivially copyable.");
+
 /** \brief Manipulation manager.
 
     Manipulation manager sets object pose and hand poses.
@@ -77,12 +111,39 @@ public:
     //! Horizon of object trajectory [sec]
     double objHorizon = 2.0;
 
+    /** \brief Whether to rebuild the object pose function only when its knots change
+
+        If true, the object pose function is kept as long as the waypoint queue is not modified and the horizon end
+        does not pass its last knot. The holding knot at the end is placed one extra horizon ahead so that a stationary
+        object is rebuilt only once per horizon. This is available only for the "BangBang" interpolator, whose
+        trajectory is identical to that of the non-incremental mode. With the "Cubic" interpolator, the knot placement
+        changes the tangents at the waypoints, so this is disabled when the configuration is loaded.
+    */
+    bool incrementalObjTraj = false;
+
     //! Object pose topic name (not subscribe if empty)
     std::string objPoseTopic;
 
     //! Object velocity topic name (not subscribe if empty)
     std::string objVelTopic;
 
+    /** \brief Whether to call ROS callbacks of object topics in a dedicated spinner thread
+
+        If false, the callbacks are called in update() on the control thread. In both cases, the callbacks only store
+        the received data in lock-free buffers, which are read at the beginning of update().
+    */
+    bool useAsyncSpinner = false;
+
+    /** \brief Whether to compensate the latency of object pose measurement
+
+        If true, the real object pose is estimated at the current ROS time from the time stamps of the measurements, by
+        extrapolation with the measured object velocity (or with the latest two poses if no velocity is received).
+    */
+    bool objLatencyCompensation = false;
+
+    //! Maximum duration of extrapolation for latency compensation [sec]
+    double maxObjExtrapolationDuration = 0.1;
+
     //! Stiffness of hand task
     double handTaskStiffness = 1000.0;
 
@@ -96,12 +157,12 @@ public:
     double reachHandDistThre = 0.5;
 
     //! Transformations from object to hand
-    std::unordered_map<Hand, sva::PTransformd> objToHandTranss = {
+    EnumArray<Hand, sva::PTransformd> objToHandTranss = {
         {Hand::Left, sva::PTransformd(sva::RotY(-1 * mc_rtc::constants::PI / 2), Eigen::Vector3d(0, 0.4, 0))},
         {Hand::Right, sva::PTransformd(sva::RotY(-1 * mc_rtc::constants::PI / 2), Eigen::Vector3d(0, -0.4, 0))}};
 
     //! Transformations for pre-reach
-    std::unordered_map<Hand, sva::PTransformd> preReachTranss = {
+    EnumArray<Hand, sva::PTransformd> preReachTranss = {
         {Hand::Left, sva::PTransformd(Eigen::Vector3d(0, 0, 0.1))},
         {Hand::Right, sva::PTransformd(Eigen::Vector3d(0, 0, 0.1))}};
 
@@ -123,15 +184,89 @@ public:
     //! Duration ratio of double support phase
     double doubleSupportRatio = 0.35;
 
+    /** \brief Number of footsteps kept in the footstep queue when following the object (zero for all at once)
+
+        Footsteps following the object are generated incrementally from the front so that the cost of each control
+        cycle does not depend on the length of the waypoint queue. The resulting footsteps are the same as those
+        generated all at once. The footsteps in the queue should cover the horizon of the centroidal manager. At least
+        two footsteps are kept.
+    */
+    int footstepQueueSize = 4;
+
+    /** \brief Whether to plan all the footsteps following the object in a background thread
+
+        If true, the footsteps are planned from a snapshot of the waypoint queue in a background thread, and the
+        finished plan is appended to the footstep queue at once at the beginning of a control cycle. footstepQueueSize
+        is not used in this case. If the plan is finished after its first footstep should have started, the footsteps
+        are generated in the control thread instead. The background thread is started only when this is enabled.
+    */
+    bool asyncFootstepPlan = false;
+
     //! Scale of hand force arrow (zero for no visualization)
     double handForceArrowScale = 0.02;
 
+    //! Number of control cycles between updates of markers (waypoints and hand force arrows)
+    int markerUpdateDecimation = 20;
+
+    //! Maximum number of waypoints visualized from the front of the waypoint queue
+    int maxWaypointMarkerNum = 100;
+
+    //! Number of control cycles between samples of logged object state (pose and velocity), which is written to a
+    //! separate log file if greater than 1
+    int objStateLogDecimation = 1;
+
     /** \brief Load mc_rtc configuration.
         \param mcRtcConfig mc_rtc configuration
     */
     void load(const mc_rtc::Configuration & mcRtcConfig);
   };
 
+  /** \brief Time-stamped profile of relative target velocity of object in the velocity mode.
+
+      The velocity of each point is held until the time of the next point. The velocity of the first point is also used
+      before its time. The last point gives the end time of the profile, after which the object stops (i.e., the
+      velocity of the last point is not used). The type is trivially copyable so that it can be passed through
+      LatestValueBuffer.
+  */
+  struct VelProfile
+  {
+    //! Maximum number of points
+    static constexpr size_t maxPointNum = 64;
+
+    //! Number of points
+    size_t pointNum = 0;
+
+    //! Times of points [sec] (in ascending order)
+    std::array<double, maxPointNum> times = {};
+
+    //! Relative target velocities of points (x [m/s], y [m/s], theta [rad/s])
+    std::array<std::array<double, 3>, maxPointNum> vels = {};
+
+    /** \brief Get relative target velocity of point.
+        \param idx index of point
+    */
+    inline Eigen::Vector3d vel(size_t idx) const
+    {
+      return Eigen::Vector3d(vels[idx][0], vels[idx][1], vels[idx][2]);
+    }
+
+    /** \brief Get end time of the profile [sec]. */
+    inline double endTime() const
+    {
+      return times[pointNum - 1];
+    }
+
+    /** \brief Get relative target velocity at the specified time (zero after the end time).
+        \param t time [sec]
+    */
+    Eigen::Vector3d velAt(double t) const;
+
+    /** \brief Check whether the profile is valid.
+        \return whether the profile is valid (an error is printed if not)
+    */
+    bool validate() const;
+  };
+
   /** \brief Velocity mode data.
 
       In the velocity mode, the object is moved at the specified velocity.
@@ -145,6 +280,16 @@ public:
       //! Whether the object moves nonholonomic, like a wheel.
       bool nonholonomicObjectMotion = true;
 
+      /** \brief Number of bisection iterations to search for the largest feasible object step
+
+          The object step along the target velocity is scaled so that the next footstep is in reachability. The
+          resolution of the scale is 2^(-feasibleStepSearchNum).
+      */
+      int feasibleStepSearchNum = 10;
+
+      //! Maximum number of footsteps planned ahead along the velocity profile until its end time
+      int maxPreviewStepNum = 10;
+
       /** \brief Load mc_rtc configuration.
           \param mcRtcConfig mc_rtc configuration
       */
@@ -171,14 +316,251 @@ public:
     //! Relative target velocity of object in the velocity mode (x [m/s], y [m/s], theta [rad/s])
     Eigen::Vector3d targetVel_ = Eigen::Vector3d::Zero();
 
+    //! Profile of relative target velocity (targetVel_ is used if the profile is empty)
+    VelProfile velProfile_;
+
     //! Pointer to the front footstep in the footstep queue
     const Footstep * frontFootstep_ = nullptr;
 
     //! Pose of the front waypoint in the waypoint queue
     sva::PTransformd frontWaypointPose_ = sva::PTransformd::Identity();
 
+    //! Pose of the waypoint before the front waypoint (i.e., the object pose when the front footstep starts)
+    sva::PTransformd prevWaypointPose_ = sva::PTransformd::Identity();
+
     //! Object transformation in one footstep duration
     Eigen::Vector3d objDeltaTrans_ = Eigen::Vector3d::Zero();
+
+    //! Number of waypoints planned ahead along the velocity profile, which are at the back of the waypoint queue
+    size_t previewWaypointNum_ = 0;
+
+    //! Whether to require planning the waypoints ahead along the velocity profile
+    bool requirePreview_ = false;
+  };
+
+  /** \brief Configuration of footstep generation following the object.
+
+      This is copied from the configurations of ManipManager and FootManager when the generation is started, so that
+      the footsteps can be calculated in the background thread without accessing the managers.
+  */
+  struct FootstepGenConfig
+  {
+    //! Duration of one footstep. [sec]
+    double footstepDuration = 0.0;
+
+    //! Duration ratio of double support phase
+    double doubleSupportRatio = 0.0;
+
+    //! Transformation from object to foot midpose
+    sva::PTransformd objToFootMidTrans = sva::PTransformd::Identity();
+
+    //! Transformations from foot midpose to each foot
+    std::unordered_map<Foot, sva::PTransformd> midToFootTranss;
+
+    //! Limit of foot midpose transformation in one footstep (x [m], y [m], theta [rad])
+    Eigen::Vector3d deltaTransLimit = Eigen::Vector3d::Zero();
+
+    /** \brief Clamp foot midpose transformation in one footstep in the same way as FootManager::clampDeltaTrans.
+        \param deltaTrans foot midpose transformation (x [m], y [m], theta [rad])
+        \param foot foot of the footstep
+
+        The agreement with FootManager::clampDeltaTrans is checked in the tests.
+    */
+    Eigen::Vector3d clampDeltaTrans(const Eigen::Vector3d & deltaTrans, const Foot & foot) const;
+
+    /** \brief Make a footstep.
+        \param foot foot
+        \param footMidpose middle pose of both feet
+        \param startTime time to start the footstep
+    */
+    Footstep makeFootstep(const Foot & foot, const sva::PTransformd & footMidpose, double startTime) const;
+  };
+
+  /** \brief State of footstep generation following the object. */
+  struct FootstepGenState
+  {
+    //! Whether footsteps are being generated
+    bool active = false;
+
+    //! Foot of the next footstep
+    Foot foot = Foot::Left;
+
+    //! Foot midpose of the last generated footstep
+    sva::PTransformd footMidpose = sva::PTransformd::Identity();
+
+    //! Start time of the next footstep [sec]
+    double startTime = 0.0;
+
+    //! End time of the waypoint queue when the generation is started [sec]
+    double endTime = 0.0;
+
+    //! Configuration copied when the generation is started
+    FootstepGenConfig config;
+  };
+
+  /** \brief Data of footstep planning in the background thread.
+
+      The data is passed between the control thread and the background thread by swapping the buffers, so that the
+      memory of the buffers is reused. The background thread accesses only this data.
+  */
+  struct FootstepPlanData
+  {
+    //! Request ID
+    uint64_t id = 0;
+
+    //! Snapshot of the waypoint queue
+    std::deque<Waypoint> waypointQueue;
+
+    //! Generation of the waypoint queue from which the snapshot is copied (zero if the snapshot is invalid)
+    uint64_t waypointQueueGen = 0;
+
+    //! Total number of waypoints removed from the front of the waypoint queue when the snapshot is copied
+    size_t waypointPopCount = 0;
+
+    //! Snapshot of the last waypoint pose
+    sva::PTransformd lastWaypointPose = sva::PTransformd::Identity();
+
+    //! Time when the planning is started [sec]
+    double t = 0.0;
+
+    //! Horizon of object trajectory [sec]
+    double objHorizon = 0.0;
+
+    //! Duration from the start time to the holding knot of object trajectory [sec]
+    double objHoldDuration = 0.0;
+
+    //! State of footstep generation
+    FootstepGenState genState;
+
+    //! Planned footsteps
+    std::vector<Footstep> footsteps;
+  };
+
+  /** \brief Snapshot of reference data.
+
+      The snapshot is updated once every control cycle in update() and gives a consistent view of the references to
+      the manipulation phases, the centroidal manager, the GUI, and the logger.
+  */
+  struct RefSnapshot
+  {
+    //! Time [sec]
+    double t = 0.0;
+
+    //! Object pose that "does not" include an offset pose
+    sva::PTransformd objPoseWithoutOffset = sva::PTransformd::Identity();
+
+    //! Object pose offset
+    sva::PTransformd objPoseOffset = sva::PTransformd::Identity();
+
+    //! Object pose that includes an offset pose (i.e., pose of control object)
+    sva::PTransformd objPose = sva::PTransformd::Identity();
+
+    //! Object velocity
+    sva::MotionVecd objVel = sva::MotionVecd::Zero();
+
+    //! Hand wrenches in the hand frame
+    EnumArray<Hand, sva::ForceVecd> handWrenches = {{Hand::Left, sva::ForceVecd::Zero()},
+                                                    {Hand::Right, sva::ForceVecd::Zero()}};
+
+    //! Manipulation phase labels
+    EnumArray<Hand, ManipPhaseLabel> manipPhaseLabels = {{Hand::Left, ManipPhaseLabel::Free},
+                                                         {Hand::Right, ManipPhaseLabel::Free}};
+
+    //! Target poses of hand tasks
+    EnumArray<Hand, sva::PTransformd> handTargetPoses = {{Hand::Left, sva::PTransformd::Identity()},
+                                                         {Hand::Right, sva::PTransformd::Identity()}};
+  };
+
+  /** \brief Copy of the reference functions of object pose and hand wrenches.
+
+      The control thread copies the data from which the functions are built, and the functions are rebuilt by build()
+      so that they can be evaluated in another thread while the control thread updates the original ones.
+  */
+  struct RefFuncSnapshot
+  {
+    //! Waypoints used to build the object pose function (those after the end of the function are not copied)
+    std::vector<Waypoint> waypoints;
+
+    //! Last waypoint pose
+    sva::PTransformd lastWaypointPose = sva::PTransformd::Identity();
+
+    //! Time when the object pose function is built [sec]
+    double objPoseFuncTime = 0.0;
+
+    //! Horizon of object trajectory [sec]
+    double objHorizon = 0.0;
+
+    //! Duration from the build time to the holding knot of object trajectory [sec]
+    double objHoldDuration = 0.0;
+
+    //! Whether to use bang-bang interpolation for the object pose
+    bool bangBangObjPose = false;
+
+    //! Object pose offset (assumed to be constant)
+    sva::PTransformd objPoseOffset = sva::PTransformd::Identity();
+
+    //! Transformations from object to hands
+    EnumArray<Hand, sva::PTransformd> objToHandTranss = {{Hand::Left, sva::PTransformd::Identity()},
+                                                         {Hand::Right, sva::PTransformd::Identity()}};
+
+    //! Manipulation phase labels
+    EnumArray<Hand, ManipPhaseLabel> manipPhaseLabels = {{Hand::Left, ManipPhaseLabel::Free},
+                                                         {Hand::Right, ManipPhaseLabel::Free}};
+
+    //! Points of the reference hand wrench functions
+    EnumArray<Hand, std::vector<std::pair<double, sva::ForceVecd>>> handWrenchPoints;
+
+    //! Object pose function rebuilt by build()
+    std::shared_ptr<TrajColl::Interpolator<sva::PTransformd, sva::MotionVecd>> objPoseFunc;
+
+    //! Reference hand wrench functions rebuilt by build()
+    EnumArray<Hand, std::shared_ptr<TrajColl::CubicInterpolator<sva::ForceVecd>>> handWrenchFuncs;
+
+    /** \brief Rebuild the functions from the copied data. */
+    void build();
+
+    /** \brief Calculate reference object pose that "does not" include an offset pose.
+        \param t time
+
+        build() must be called in advance.
+    */
+    inline sva::PTransformd calcRefObjPose(double t) const
+    {
+      return (*objPoseFunc)(t);
+    }
+
+    /** \brief Calculate reference hand wrench in the hand frame.
+        \param hand hand
+        \param t time
+
+        build() must be called in advance.
+    */
+    inline sva::ForceVecd calcRefHandWrench(const Hand & hand, double t) const
+    {
+      return (*handWrenchFuncs.at(hand))(t);
+    }
+  };
+
+  /** \brief Histograms of computation time of the steps in update(). */
+  struct UpdateTimings
+  {
+    //! Update of real object
+    TimingHistogram realObj;
+
+    //! Update for velocity mode
+    TimingHistogram velMode;
+
+    //! Update of object trajectory
+    TimingHistogram objTraj;
+
+    //! Update of hand trajectory
+    TimingHistogram handTraj;
+
+    //! Update of footstep
+    TimingHistogram footstep;
+
+    //! Update of marker state
+    TimingHistogram markerState;
   };
 
 public:
@@ -188,6 +570,9 @@ public:
   */
   ManipManager(LocomanipController * ctlPtr, const mc_rtc::Configuration & mcRtcConfig = {});
 
+  /** \brief Destructor. */
+  ~ManipManager();
+
   /** \brief Reset.
 
       This method should be called once when controller is reset.
@@ -218,6 +603,26 @@ public:
     return velModeData_;
   }
 
+  /** \brief Const accessor to the histograms of computation time of the steps in update(). */
+  inline const UpdateTimings & updateTimings() const noexcept
+  {
+    return updateTimings_;
+  }
+
+  /** \brief Const accessor to the snapshot of reference data in the current control cycle. */
+  inline const RefSnapshot & refSnapshot() const noexcept
+  {
+    return refSnapshot_;
+  }
+
+  /** \brief Copy the reference functions of object pose and hand wrenches.
+      \param snapshot copy of the reference functions
+
+      The number of copied waypoints is bounded by the object horizon because only the waypoints used in the object
+      pose function are copied.
+  */
+  void copyRefFuncs(RefFuncSnapshot & snapshot) const;
+
   /** \brief Add entries to the GUI. */
   void addToGUI(mc_rtc::gui::StateBuilder & gui);
 
@@ -300,7 +705,7 @@ public:
   };
 
   /** \brief Get manipulation phase. */
-  inline const std::shared_ptr<ManipPhase::Base> & manipPhase(const Hand & hand) const
+  inline const ManipPhase::Machine & manipPhase(const Hand & hand) const
   {
     return manipPhases_.at(hand);
   }
@@ -329,6 +734,28 @@ public:
   /** \brief Require sending footstep command following an object. */
   void requireFootstepFollowingObj();
 
+  /** \brief Whether the footsteps following the object are required or being planned in the background thread.
+
+      If this returns false after requireFootstepFollowingObj is called, the planned footsteps have been appended to
+      the footstep queue (or the planning has failed).
+  */
+  inline bool planningFootstep() const noexcept
+  {
+    return requireFootstepFollowingObj_ || footstepPlanPendingId_ > 0;
+  }
+
+  /** \brief Whether footsteps following the object are being planned or generated. */
+  inline bool generatingFootstep() const noexcept
+  {
+    return planningFootstep() || footstepGenState_.active;
+  }
+
+  /** \brief Get progress of footstep planning in the background thread (from 0 to 1). */
+  inline double footstepPlanProgress() const noexcept
+  {
+    return footstepPlanProgress_.load(std::memory_order_relaxed);
+  }
+
   /** \brief Start velocity mode.
       \return whether it is successfully started
    */
@@ -344,12 +771,67 @@ public:
    */
   void setRelativeVel(const Eigen::Vector3d & targetVel);
 
+  /** \brief Set the profile of relative target velocity.
+      \param velProfile profile of relative target velocity of object in the velocity mode
+      \return whether the profile is successfully set
+
+      The footsteps and the object waypoints are planned ahead until the end time of the profile, where the object
+      stops. The object step of each footstep is calculated by integrating the profile over the footstep duration, and
+      the waypoints of the planned footsteps are added to the waypoint queue. The profile is cleared by setRelativeVel.
+   */
+  bool setRelativeVelProfile(const VelProfile & velProfile);
+
   /** \brief Whether the velocity mode (i.e., moving the object at the relative target velocity) is enabled. */
   inline bool velModeEnabled() const
   {
     return velModeData_.enabled_;
   }
 
+protected:
+  /** \brief Object pose received from ROS topic. */
+  struct ObjPoseMsgData
+  {
+    //! Time stamp [sec]
+    double stamp = 0.0;
+
+    //! Position (x, y, z)
+    std::array<double, 3> position = {0.0, 0.0, 0.0};
+
+    //! Orientation quaternion (w, x, y, z)
+    std::array<double, 4> orientation = {1.0, 0.0, 0.0, 0.0};
+  };
+
+  /** \brief Object velocity received from ROS topic. */
+  struct ObjVelMsgData
+  {
+    //! Angular velocity (x, y, z)
+    std::array<double, 3> angular = {0.0, 0.0, 0.0};
+
+    //! Linear velocity (x, y, z)
+    std::array<double, 3> linear = {0.0, 0.0, 0.0};
+  };
+
+  /** \brief State of markers for visualization. */
+  struct MarkerState
+  {
+    //! Poses of waypoints (the first element is the current object pose)
+    std::vector<sva::PTransformd> waypointPoses;
+
+    //! Start positions of hand force arrows
+    EnumArray<Hand, Eigen::Vector3d> handForceArrowStarts = {{Hand::Left, Eigen::Vector3d::Zero()},
+                                                             {Hand::Right, Eigen::Vector3d::Zero()}};
+
+    //! End positions of hand force arrows
+    EnumArray<Hand, Eigen::Vector3d> handForceArrowEnds = {{Hand::Left, Eigen::Vector3d::Zero()},
+                                                           {Hand::Right, Eigen::Vector3d::Zero()}};
+
+    //! Whether hand force arrows are visible (hidden arrows are placed at hiddenPos)
+    EnumArray<Hand, bool> handForceArrowVisibles = {{Hand::Left, false}, {Hand::Right, false}};
+
+    //! Position far below the ground where the hidden markers are placed
+    static inline const Eigen::Vector3d hiddenPos = Eigen::Vector3d(0.0, 0.0, -1e3);
+  };
+
 protected:
   /** \brief Const accessor to the controller. */
   inline const LocomanipController & ctl() const
@@ -366,15 +848,139 @@ protected:
   /** \brief Update object trajectory. */
   virtual void updateObjTraj();
 
+  /** \brief Set the knots of object pose function from the waypoint queue.
+      \param objPoseFunc object pose function
+      \param endTime time until which the waypoints are added
+
+      The waypoints after the first one ending at or after endTime are not added. The number of visited waypoints is
+      added to waypointVisitNum_.
+  */
+  void setObjPoseFuncPoints(TrajColl::Interpolator<sva::PTransformd, sva::MotionVecd> & objPoseFunc, double endTime);
+
+  /** \brief Set the knots of object pose function from the specified waypoint queue.
+      \tparam WaypointContainer container of waypoints
+      \param objPoseFunc object pose function
+      \param waypointQueue waypoint queue
+      \param lastWaypointPose last waypoint pose
+      \param t current time [sec]
+      \param endTime time until which the waypoints are added
+      \param objHorizon horizon of object trajectory [sec]
+      \param objHoldDuration duration from t to the holding knot added if the waypoints end within the horizon [sec]
+      \return number of visited waypoints
+
+      This method does not access the manager, so it can be called from the background thread.
+  */
+  template<class WaypointContainer>
+  static size_t setObjPoseFuncPoints(TrajColl::Interpolator<sva::PTransformd, sva::MotionVecd> & objPoseFunc,
+                                     const WaypointContainer & waypointQueue,
+                                     const sva::PTransformd & lastWaypointPose,
+                                     double t,
+                                     double endTime,
+                                     double objHorizon,
+                                     double objHoldDuration);
+
+  /** \brief Update snapshot of reference data from the current interpolation functions and manipulation phases. */
+  void updateRefSnapshot();
+
   /** \brief Update hand tasks. */
   virtual void updateHandTraj();
 
   /** \brief Update footstep. */
   virtual void updateFootstep();
 
+  /** \brief Integrate relative target velocity of object.
+      \param startTime start time of integration [sec]
+      \param endTime end time of integration [sec]
+  */
+  Eigen::Vector3d integrateRelativeVel(double startTime, double endTime) const;
+
+  /** \brief Initialize the state of footstep generation following the object.
+      \param state state of footstep generation
+      \return whether it is successfully initialized
+
+      The configuration of the generation is copied to the state.
+  */
+  bool initFootstepGenState(FootstepGenState & state) const;
+
+  /** \brief Calculate the next footstep following the object.
+      \param state state of footstep generation
+      \param objPoseFunc object pose function covering the whole waypoint queue
+
+      The generation is finished (i.e., state.active is set to false) after the footstep that is started after the end
+      of the waypoint queue is calculated. This method uses only the configuration copied to the state, so it can be
+      called from the background thread.
+  */
+  static Footstep calcNextFootstep(FootstepGenState & state,
+                                   const TrajColl::Interpolator<sva::PTransformd, sva::MotionVecd> & objPoseFunc);
+
+  /** \brief Start generating footsteps following the object incrementally in the control thread. */
+  void startFootstepGen();
+
+  /** \brief Build the object pose function for footstep generation if the next footstep passes its end.
+      \param force whether to build the function regardless of the next footstep
+
+      The function is built only up to the horizon after the next footstep so that the cost in each control cycle
+      does not depend on the length of the waypoint queue.
+  */
+  void updateFootstepObjPoseFunc(bool force);
+
+  /** \brief Start footstep planning in the background thread.
+
+      The waypoint queue is copied to the request over multiple control cycles, and the request is sent to the
+      background thread after the copy is finished.
+  */
+  void startFootstepPlan();
+
+  /** \brief Copy a bounded number of waypoints to the request, and send the request if the copy is finished. */
+  void sendFootstepPlanRequest();
+
+  /** \brief Start the background thread of footstep planning. */
+  void startFootstepPlanThread();
+
+  /** \brief Stop the background thread of footstep planning. */
+  void stopFootstepPlanThread();
+
+  /** \brief Loop of footstep planning in the background thread. */
+  void footstepPlanLoop();
+
+  /** \brief Append the footsteps planned in the background thread to the footstep queue.
+
+      The plan is kept until the footstep queue becomes empty. If the first footstep of the plan has already started,
+      the footsteps are generated in the control thread instead.
+  */
+  void handOffFootstepPlan();
+
+  /** \brief Cancel footstep planning in the background thread without waiting for it to finish. */
+  void cancelFootstepPlan();
+
+  /** \brief Update marker state for visualization.
+      \param force whether to update regardless of the decimation
+  */
+  void updateMarkerState(bool force = false);
+
+  /** \brief Get marker state read by GUI. */
+  inline const MarkerState & markerState() const
+  {
+    return markerStates_[markerStateIdx_];
+  }
+
+  /** \brief Update data for the logger. */
+  void updateLogData();
+
   /** \brief Update object and footstep for velocity mode. */
   void updateForVelMode();
 
+  /** \brief Update the pose of the last waypoint in the queue.
+      \param pose object pose
+
+      If the interpolation toward the waypoint has already started, the waypoint is restarted at the current time from
+      the current reference object pose so that the reference object pose is continuous.
+   */
+  void updateStartedWaypoint(const sva::PTransformd & pose);
+
+  /** \brief Remove the waypoints planned ahead along the velocity profile from the waypoint queue. */
+  void removeVelModePreview();
+
   /** \brief Make a footstep.
       \param foot foot
       \param footMidpose middle pose of both feet
@@ -386,6 +992,9 @@ protected:
                         double startTime,
                         const mc_rtc::Configuration & swingTrajConfig = {}) const;
 
+  /** \brief Update real object from the latest data received from ROS topics. */
+  void updateRealObj();
+
   /** \brief ROS callback of object pose topic. */
   void objPoseCallback(const geometry_msgs::PoseStamped::ConstPtr & poseStMsg);
 
@@ -402,6 +1011,12 @@ protected:
   //! Velocity mode data
   VelModeData velModeData_;
 
+  //! Snapshot of reference data
+  RefSnapshot refSnapshot_;
+
+  //! Histograms of computation time of the steps in update()
+  UpdateTimings updateTimings_;
+
   //! Pointer to controller
   LocomanipController * ctlPtr_ = nullptr;
 
@@ -414,6 +1029,16 @@ protected:
   //! Object pose function
   std::shared_ptr<TrajColl::Interpolator<sva::PTransformd, sva::MotionVecd>> objPoseFunc_;
 
+  //! Object pose function used only for footstep generation in the control thread
+  std::shared_ptr<TrajColl::Interpolator<sva::PTransformd, sva::MotionVecd>> footstepObjPoseFunc_;
+
+  //! Time until which the waypoints are added to footstepObjPoseFunc_ [sec]
+  double footstepObjPoseFuncEndTime_ = 0.0;
+
+  //! Number of waypoints visited in the current control cycle to build the object pose functions and to copy the
+  //! waypoint queue for footstep planning
+  size_t waypointVisitNum_ = 0;
+
   //! Object pose offset
   sva::PTransformd objPoseOffset_ = sva::PTransformd::Identity();
 
@@ -421,23 +1046,118 @@ protected:
   std::shared_ptr<TrajColl::CubicInterpolator<sva::PTransformd, sva::MotionVecd>> objPoseOffsetFunc_;
 
   //! Manipulation phases
-  std::unordered_map<Hand, std::shared_ptr<ManipPhase::Base>> manipPhases_;
+  EnumArray<Hand, ManipPhase::Machine> manipPhases_;
 
   //! Hand wrench functions
-  std::unordered_map<Hand, std::shared_ptr<TrajColl::CubicInterpolator<sva::ForceVecd>>> handWrenchFuncs_;
+  EnumArray<Hand, std::shared_ptr<TrajColl::CubicInterpolator<sva::ForceVecd>>> handWrenchFuncs_;
+
+  //! Marker states (double buffer of the one read by GUI and the one being updated)
+  std::array<MarkerState, 2> markerStates_;
+
+  //! Index of marker state read by GUI
+  size_t markerStateIdx_ = 0;
+
+  //! Number of control cycles since the last marker update
+  int markerUpdateCount_ = 0;
+
+  //! Decimator of logged object state
+  LogDecimator objStateLogDecimator_;
 
   //! Whether to require updating impedance gains
   bool requireImpGainUpdate_ = true;
 
+  //! Whether to require rebuilding the object pose function (used only when config_.incrementalObjTraj is true)
+  bool requireObjPoseFuncUpdate_ = true;
+
+  //! Time when the object pose function is built [sec]
+  double objPoseFuncTime_ = 0.0;
+
   //! Whether to require sending footstep command following an object
   bool requireFootstepFollowingObj_ = false;
 
+  //! State of footstep generation following the object in the control thread
+  FootstepGenState footstepGenState_;
+
+  //! Request of footstep planning being prepared in the control thread
+  FootstepPlanData footstepPlanRequest_;
+
+  //! Number of waypoints to be copied to the request
+  size_t footstepPlanWaypointNum_ = 0;
+
+  //! Generation of the waypoint queue, which is incremented when the waypoints are modified other than by appending to
+  //! the back or removing from the front
+  uint64_t waypointQueueGen_ = 1;
+
+  //! Total number of waypoints removed from the front of the waypoint queue
+  size_t waypointPopCount_ = 0;
+
+  //! Whether the request has been sent to the background thread
+  bool footstepPlanRequestSent_ = false;
+
+  //! ID of the last request of footstep planning
+  uint64_t footstepPlanLastId_ = 0;
+
+  //! ID of the request whose plan is waiting to be handed off (zero if there is none)
+  uint64_t footstepPlanPendingId_ = 0;
+
+  //! Whether the plan is waiting for the footstep queue to become empty
+  bool footstepPlanWaitingQueue_ = false;
+
+  //! Data of footstep planning being processed in the background thread
+  FootstepPlanData footstepPlanData_;
+
+  //! Object pose function used in the background thread
+  std::shared_ptr<TrajColl::Interpolator<sva::PTransformd, sva::MotionVecd>> footstepPlanObjPoseFunc_;
+
+  //! Background thread of footstep planning
+  std::thread footstepPlanThread_;
+
+  //! Request of footstep planning passed to the background thread (guarded by footstepPlanRequestMtx_)
+  //! @{
+  std::mutex footstepPlanRequestMtx_;
+  std::condition_variable footstepPlanRequestCv_;
+  FootstepPlanData footstepPlanSharedRequest_;
+  bool footstepPlanRequested_ = false;
+  bool footstepPlanStopRequested_ = false;
+  //! @}
+
+  //! Result of footstep planning passed from the background thread (guarded by footstepPlanResultMtx_)
+  //! @{
+  std::mutex footstepPlanResultMtx_;
+  FootstepPlanData footstepPlanResult_;
+  //! @}
+
+  //! Whether a result of footstep planning is published by the background thread
+  std::atomic<bool> footstepPlanDone_ = false;
+
+  //! Whether to cancel footstep planning in the background thread
+  std::atomic<bool> footstepPlanCancelRequested_ = false;
+
+  //! Progress of footstep planning in the background thread (from 0 to 1)
+  std::atomic<double> footstepPlanProgress_ = 0.0;
+
   //! ROS variables
   //! @{
   std::shared_ptr<ros::NodeHandle> nh_;
   ros::CallbackQueue callbackQueue_;
   ros::Subscriber objPoseSub_;
   ros::Subscriber objVelSub_;
+  std::unique_ptr<ros::AsyncSpinner> spinner_;
   //! @}
+
+  //! Latest object pose received from ROS topic
+  LatestValueBuffer<ObjPoseMsgData> objPoseBuffer_;
+
+  //! Latest object velocity received from ROS topic
+  LatestValueBuffer<ObjVelMsgData> objVelBuffer_;
+
+  //! History of object pose measurements
+  StampedPoseHistory objPoseHistory_;
+
+  //! Whether object velocity has been received
+  bool objVelReceived_ = false;
+
+  //! Latency of the latest object pose measurement [sec]
+  double objPoseLatency_ = 0.0;
 };
 } // namespace LMC
@@ -1,6 +1,6 @@
 #pragma once
 
-#include <TrajColl/CubicInterpolator.h>
+#include <string>
 
 #include <LocomanipController/HandTypes.h>
 
@@ -9,7 +9,11 @@ namespace LMC
 class LocomanipController;
 class ManipManager;
 
-/** \brief Manipulation phase label. */
+/** \brief Manipulation phase label.
+
+    The labels are logged as integers, so the values must not be changed: Free (0), PreReach (1), Reach (2), Grasp (3),
+    Hold (4), Ungrasp (5), and Release (6).
+*/
 enum class ManipPhaseLabel
 {
   //! Free phase
@@ -36,7 +40,11 @@ enum class ManipPhaseLabel
 
 namespace ManipPhase
 {
-/** \brief Base of manipulation phase. */
+/** \brief Base of manipulation phase.
+
+    Manipulation phases are preallocated in ManipPhase::Machine and dispatched by label without virtual functions. The
+    process at the beginning of a phase is implemented in start() instead of the constructor.
+*/
 class Base
 {
 public:
@@ -51,24 +59,27 @@ public:
   }
 
   /** \brief Get label. */
-  virtual ManipPhaseLabel label() const
+  inline ManipPhaseLabel label() const
   {
     return label_;
   }
 
+  /** \brief Start manipulation phase. */
+  void start() {}
+
   /** \brief Run manipulation phase. */
-  virtual void run() {}
+  void run() {}
 
   /** \brief Get whether manipulation phase is completed. */
-  virtual bool complete() const
+  bool complete() const
   {
     return false;
   }
 
-  /** \brief Make next manipulation phase. */
-  virtual std::shared_ptr<Base> makeNextManipPhase() const
+  /** \brief Get label of next manipulation phase. */
+  ManipPhaseLabel nextLabel() const
   {
-    return nullptr;
+    return label_;
   }
 
 protected:
@@ -98,6 +109,9 @@ public:
       \param manipManager manipulation manager
   */
   Free(const Hand & hand, ManipManager * manipManager);
+
+  /** \brief Start manipulation phase. */
+  void start();
 };
 
 /** \brief Manipulation pre-reach phase. */
@@ -110,14 +124,17 @@ public:
   */
   PreReach(const Hand & hand, ManipManager * manipManager);
 
+  /** \brief Start manipulation phase. */
+  void start();
+
   /** \brief Run manipulation phase. */
-  virtual void run() override;
+  void run();
 
   /** \brief Get whether manipulation phase is completed. */
-  virtual bool complete() const override;
+  bool complete() const;
 
-  /** \brief Make next manipulation phase. */
-  virtual std::shared_ptr<Base> makeNextManipPhase() const override;
+  /** \brief Get label of next manipulation phase. */
+  ManipPhaseLabel nextLabel() const;
 
 protected:
   //! Phase end time [sec]
@@ -134,18 +151,27 @@ public:
   */
   Reach(const Hand & hand, ManipManager * manipManager);
 
+  /** \brief Start manipulation phase. */
+  void start();
+
   /** \brief Run manipulation phase. */
-  virtual void run() override;
+  void run();
 
   /** \brief Get whether manipulation phase is completed. */
-  virtual bool complete() const override;
+  bool complete() const;
 
-  /** \brief Make next manipulation phase. */
-  virtual std::shared_ptr<Base> makeNextManipPhase() const override;
+  /** \brief Get label of next manipulation phase. */
+  ManipPhaseLabel nextLabel() const;
 
 protected:
-  //! Function to interpolate reaching ratio
-  std::shared_ptr<TrajColl::CubicInterpolator<double>> reachingRatioFunc_;
+  //! Start time of reaching interpolation [sec]
+  double startTime_ = 0;
+
+  //! Duration of reaching interpolation [sec]
+  double duration_ = 0;
+
+  //! Whether the reaching ratio is being interpolated
+  bool reaching_ = false;
 };
 
 /** \brief Manipulation grasp phase. */
@@ -158,14 +184,17 @@ public:
   */
   Grasp(const Hand & hand, ManipManager * manipManager);
 
+  /** \brief Start manipulation phase. */
+  void start();
+
   /** \brief Run manipulation phase. */
-  virtual void run() override;
+  void run();
 
   /** \brief Get whether manipulation phase is completed. */
-  virtual bool complete() const override;
+  bool complete() const;
 
-  /** \brief Make next manipulation phase. */
-  virtual std::shared_ptr<Base> makeNextManipPhase() const override;
+  /** \brief Get label of next manipulation phase. */
+  ManipPhaseLabel nextLabel() const;
 };
 
 /** \brief Manipulation hold phase. */
@@ -179,7 +208,7 @@ public:
   Hold(const Hand & hand, ManipManager * manipManager);
 
   /** \brief Run manipulation phase. */
-  virtual void run() override;
+  void run();
 };
 
 /** \brief Manipulation ungrasp phase. */
@@ -192,14 +221,17 @@ public:
   */
   Ungrasp(const Hand & hand, ManipManager * manipManager);
 
+  /** \brief Start manipulation phase. */
+  void start();
+
   /** \brief Run manipulation phase. */
-  virtual void run() override;
+  void run();
 
   /** \brief Get whether manipulation phase is completed. */
-  virtual bool complete() const override;
+  bool complete() const;
 
-  /** \brief Make next manipulation phase. */
-  virtual std::shared_ptr<Base> makeNextManipPhase() const override;
+  /** \brief Get label of next manipulation phase. */
+  ManipPhaseLabel nextLabel() const;
 };
 
 /** \brief Manipulation release phase. */
@@ -212,18 +244,89 @@ public:
   */
   Release(const Hand & hand, ManipManager * manipManager);
 
+  /** \brief Start manipulation phase. */
+  void start();
+
   /** \brief Run manipulation phase. */
-  virtual void run() override;
+  void run();
 
   /** \brief Get whether manipulation phase is completed. */
-  virtual bool complete() const override;
+  bool complete() const;
+
+  /** \brief Get label of next manipulation phase. */
+  ManipPhaseLabel nextLabel() const;
+
+protected:
+  //! Start time of reaching interpolation [sec]
+  double startTime_ = 0;
+
+  //! Duration of reaching interpolation [sec]
+  double duration_ = 0;
+
+  //! Whether the reaching ratio is being interpolated
+  bool reaching_ = false;
+};
+
+/** \brief Calculate reaching ratio that changes from 0 to 1 with a cubic polynomial with zero velocities at both ends.
+    \param t time [sec]
+    \param startTime start time [sec]
+    \param duration duration [sec]
 
-  /** \brief Make next manipulation phase. */
-  virtual std::shared_ptr<Base> makeNextManipPhase() const override;
+    The ratio is calculated in closed form so that no memory is allocated when a phase starts. The ratio is 1 after
+    the end time.
+*/
+double calcReachingRatio(double t, double startTime, double duration);
+
+/** \brief Manipulation phase machine of one hand.
+
+    All the manipulation phases are preallocated and the current one is selected by label, so that phase transitions
+    do not allocate the phases and the phases are dispatched without virtual functions.
+*/
+class Machine
+{
+public:
+  /** \brief Constructor.
+      \param hand hand
+      \param manipManager manipulation manager
+  */
+  Machine(const Hand & hand, ManipManager * manipManager);
+
+  /** \brief Get label of current manipulation phase. */
+  inline ManipPhaseLabel label() const
+  {
+    return label_;
+  }
+
+  /** \brief Start manipulation phase.
+      \param label manipulation phase label
+  */
+  void start(const ManipPhaseLabel & label);
+
+  /** \brief Run current manipulation phase and switch to the next one if it is completed. */
+  void run();
+
+protected:
+  /** \brief Run manipulation phase and switch to the next one if it is completed.
+      \tparam PhaseType type of manipulation phase
+      \param phase manipulation phase
+  */
+  template<class PhaseType>
+  void runPhase(PhaseType & phase);
 
 protected:
-  //! Function to interpolate reaching ratio
-  std::shared_ptr<TrajColl::CubicInterpolator<double>> reachingRatioFunc_;
+  //! Label of current manipulation phase
+  ManipPhaseLabel label_ = ManipPhaseLabel::Free;
+
+  //! Manipulation phases
+  //! @{
+  Free free_;
+  PreReach preReach_;
+  Reach reach_;
+  Grasp grasp_;
+  Hold hold_;
+  Ungrasp ungrasp_;
+  Release release_;
+  //! @}
 };
 } // namespace ManipPhase
 } // namespace LMC
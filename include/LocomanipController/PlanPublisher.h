@@ -0,0 +1,204 @@
+#pragma once
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include <mc_rtc/Configuration.h>
+
+#include <ros/ros.h>
+
+#include <LocomanipController/FootTypes.h>
+
+namespace LMC
+{
+class LocomanipController;
+
+/** \brief Publisher of the planned object path, footsteps, and ext-ZMP to ROS topics.
+
+    In the control thread, the plan is copied into a ring buffer of preallocated snapshots without locking. In the
+    background thread, the latest snapshot is converted to ROS messages and published at the specified rate, so that
+    the control thread never blocks on ROS serialization. Snapshots are dropped if the ring buffer is full.
+*/
+class PlanPublisher
+{
+public:
+  /** \brief Configuration. */
+  struct Configuration
+  {
+    //! Whether to enable publishing
+    bool enabled = false;
+
+    //! Publishing rate [Hz]
+    double publishRate = 10.0;
+
+    //! Frame ID of published messages
+    std::string frameId = "robot_map";
+
+    //! Namespace of published topics
+    std::string topicNamespace = "plan";
+
+    //! Number of snapshots in the ring buffer
+    int bufferSize = 4;
+
+    //! Maximum number of waypoints published from the front of the waypoint queue
+    int maxWaypointNum = 100;
+
+    //! Maximum number of footsteps published from the front of the footstep queue
+    int maxFootstepNum = 20;
+
+    //! Maximum number of ext-ZMP samples published over the preview horizon
+    int maxExtZmpNum = 200;
+
+    //! Size of footstep marker [m]
+    Eigen::Vector3d footstepMarkerSize = Eigen::Vector3d(0.2, 0.1, 0.01);
+
+    /** \brief Load mc_rtc configuration.
+        \param mcRtcConfig mc_rtc configuration
+    */
+    void load(const mc_rtc::Configuration & mcRtcConfig);
+  };
+
+  /** \brief Planned footstep. */
+  struct PlannedFootstep
+  {
+    //! Foot
+    Foot foot = Foot::Left;
+
+    //! Foot pose
+    sva::PTransformd pose = sva::PTransformd::Identity();
+
+    //! Time to start swinging the foot [sec]
+    double swingStartTime = 0.0;
+
+    //! Time to end swinging the foot [sec]
+    double swingEndTime = 0.0;
+  };
+
+  /** \brief Snapshot of the plan.
+
+      The vectors are allocated with the maximum sizes in reset() and are not resized afterwards; only the first
+      elements up to the corresponding numbers are valid.
+  */
+  struct Snapshot
+  {
+    //! Time [sec]
+    double t = 0.0;
+
+    //! Object poses of the current object and waypoints
+    std::vector<sva::PTransformd> objPoses;
+
+    //! Number of valid object poses
+    size_t objPoseNum = 0;
+
+    //! Footsteps
+    std::vector<PlannedFootstep> footsteps;
+
+    //! Number of valid footsteps
+    size_t footstepNum = 0;
+
+    //! Reference ext-ZMPs
+    std::vector<Eigen::Vector3d> extZmps;
+
+    //! Number of valid reference ext-ZMPs
+    size_t extZmpNum = 0;
+  };
+
+public:
+  /** \brief Constructor.
+      \param ctlPtr pointer to controller
+      \param mcRtcConfig mc_rtc configuration
+  */
+  PlanPublisher(LocomanipController * ctlPtr, const mc_rtc::Configuration & mcRtcConfig = {});
+
+  /** \brief Destructor. */
+  ~PlanPublisher();
+
+  /** \brief Reset.
+
+      This method should be called once when controller is reset.
+  */
+  void reset();
+
+  /** \brief Update.
+
+      This method should be called once every control cycle after the managers are updated.
+  */
+  void update();
+
+  /** \brief Stop.
+
+      This method should be called once when stopping the controller.
+  */
+  void stop();
+
+  /** \brief Const accessor to the configuration. */
+  inline const Configuration & config() const noexcept
+  {
+    return config_;
+  }
+
+  /** \brief Get number of snapshots dropped because the ring buffer was full. */
+  inline size_t droppedNum() const noexcept
+  {
+    return droppedNum_;
+  }
+
+protected:
+  /** \brief Const accessor to the controller. */
+  inline const LocomanipController & ctl() const
+  {
+    return *ctlPtr_;
+  }
+
+  /** \brief Copy the plan into a snapshot.
+      \param snapshot snapshot to be filled
+  */
+  void fillSnapshot(Snapshot & snapshot) const;
+
+  /** \brief Loop of publishing thread. */
+  void publishLoop();
+
+  /** \brief Stop publishing thread. */
+  void stopPublishThread();
+
+protected:
+  //! Configuration
+  Configuration config_;
+
+  //! Pointer to controller
+  LocomanipController * ctlPtr_ = nullptr;
+
+  //! Number of control cycles between snapshots
+  int decimation_ = 1;
+
+  //! Number of control cycles since the last snapshot
+  int updateCount_ = 0;
+
+  //! Ring buffer of snapshots
+  std::vector<Snapshot> snapshots_;
+
+  //! Number of snapshots written by the control thread
+  std::atomic<size_t> writeCount_ = 0;
+
+  //! Number of snapshots read by the publishing thread
+  std::atomic<size_t> readCount_ = 0;
+
+  //! Number of snapshots dropped because the ring buffer was full
+  size_t droppedNum_ = 0;
+
+  //! Publishing thread
+  std::thread publishThread_;
+
+  //! Whether to stop publishing thread
+  std::atomic<bool> stopRequested_ = false;
+
+  //! ROS variables
+  //! @{
+  std::shared_ptr<ros::NodeHandle> nh_;
+  ros::Publisher objPathPub_;
+  ros::Publisher footstepMarkerPub_;
+  ros::Publisher extZmpPathPub_;
+  //! @}
+};
+} // namespace LMC
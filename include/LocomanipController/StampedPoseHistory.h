@@ -0,0 +1,79 @@
+#pragma once
+
+#include <array>
+
+#include <SpaceVecAlg/SpaceVecAlg>
+
+namespace LMC
+{
+/** \brief Fixed-size history of time-stamped poses.
+
+    This is used to estimate the pose at the control time from delayed measurements.
+*/
+class StampedPoseHistory
+{
+public:
+  //! Maximum number of poses kept in the history
+  static constexpr size_t capacity = 16;
+
+public:
+  /** \brief Clear history. */
+  void clear();
+
+  /** \brief Add a pose.
+      \param stamp time stamp [sec]
+      \param pose pose
+      \return whether the pose is added (poses older than the latest one are ignored)
+
+      The oldest pose is discarded if the history is full.
+  */
+  bool push(double stamp, const sva::PTransformd & pose);
+
+  /** \brief Get whether the history is empty. */
+  inline bool empty() const
+  {
+    return size_ == 0;
+  }
+
+  /** \brief Get number of poses in the history. */
+  inline size_t size() const
+  {
+    return size_;
+  }
+
+  /** \brief Get time stamp of the latest pose. */
+  double latestStamp() const;
+
+  /** \brief Get the latest pose. */
+  const sva::PTransformd & latestPose() const;
+
+  /** \brief Calculate pose at the specified time.
+      \param t time [sec]
+      \param maxExtrapDuration maximum duration of extrapolation after the latest pose [sec]
+
+      The pose is interpolated between the poses before and after t. After the latest pose, the pose is extrapolated
+      from the latest two poses. Before the oldest pose, the oldest pose is returned. The history must not be empty.
+  */
+  sva::PTransformd calcPose(double t, double maxExtrapDuration) const;
+
+protected:
+  /** \brief Get index in the ring buffer of the i-th element from the oldest one. */
+  inline size_t ringIdx(size_t i) const
+  {
+    return (headIdx_ + i) % capacity;
+  }
+
+protected:
+  //! Time stamps of poses
+  std::array<double, capacity> stamps_ = {};
+
+  //! Poses
+  std::array<sva::PTransformd, capacity> poses_;
+
+  //! Index of the oldest element
+  size_t headIdx_ = 0;
+
+  //! Number of elements
+  size_t size_ = 0;
+};
+} // namespace LMC
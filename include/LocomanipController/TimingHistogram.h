@@ -0,0 +1,135 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+
+#include <mc_rtc/gui/StateBuilder.h>
+#include <mc_rtc/log/Logger.h>
+
+namespace LMC
+{
+/** \brief Histogram of computation time with fixed logarithmic bins.
+
+    The bins are fixed in advance so that adding a sample and calculating a percentile do not allocate memory. The bins
+    are spaced logarithmically between minDuration and maxDuration, so the percentiles have a constant relative
+    resolution (about 10%). Samples out of the range are counted in the first or last bin.
+*/
+class TimingHistogram
+{
+public:
+  /** \brief Timer that adds the duration from its construction to its destruction to the histogram. */
+  class ScopedTimer
+  {
+  public:
+    /** \brief Constructor.
+        \param histogram histogram to add the duration
+    */
+    explicit ScopedTimer(TimingHistogram & histogram)
+    : histogram_(histogram), startTime_(std::chrono::steady_clock::now())
+    {
+    }
+
+    /** \brief Destructor. */
+    ~ScopedTimer()
+    {
+      histogram_.add(std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime_).count());
+    }
+
+  protected:
+    //! Histogram
+    TimingHistogram & histogram_;
+
+    //! Start time
+    std::chrono::steady_clock::time_point startTime_;
+  };
+
+public:
+  //! Number of bins
+  static constexpr size_t binNum = 128;
+
+  //! Lower bound of the first bin [sec]
+  static constexpr double minDuration = 1e-6;
+
+  //! Upper bound of the last bin [sec]
+  static constexpr double maxDuration = 1e-1;
+
+public:
+  /** \brief Clear samples.
+      \param deadline duration over which a sample is counted as an overrun [sec] (no overrun is counted if zero)
+  */
+  void reset(double deadline);
+
+  /** \brief Add a sample.
+      \param duration computation time [sec]
+  */
+  void add(double duration);
+
+  /** \brief Get number of samples. */
+  inline size_t count() const noexcept
+  {
+    return count_;
+  }
+
+  /** \brief Get the latest sample [sec]. */
+  inline double latest() const noexcept
+  {
+    return latest_;
+  }
+
+  /** \brief Get the maximum sample [sec]. */
+  inline double max() const noexcept
+  {
+    return max_;
+  }
+
+  /** \brief Get number of samples over the deadline. */
+  inline size_t overrunNum() const noexcept
+  {
+    return overrunNum_;
+  }
+
+  /** \brief Calculate percentile [sec].
+      \param ratio ratio of the percentile (e.g., 0.99 for p99)
+
+      The upper bound of the bin containing the percentile is returned (it does not exceed the maximum sample). Zero is
+      returned if there is no sample.
+  */
+  double percentile(double ratio) const;
+
+  /** \brief Add entries to the logger.
+      \param logger logger
+      \param name prefix of entry names
+      \param source source of entries (used to remove them)
+  */
+  void addToLogger(mc_rtc::Logger & logger, const std::string & name, const void * source) const;
+
+  /** \brief Add entries to the GUI.
+      \param gui GUI
+      \param category category of entries
+      \param name label name
+  */
+  void addToGUI(mc_rtc::gui::StateBuilder & gui,
+                const std::vector<std::string> & category,
+                const std::string & name) const;
+
+protected:
+  //! Number of samples in each bin
+  std::array<size_t, binNum> binCounts_ = {};
+
+  //! Number of samples
+  size_t count_ = 0;
+
+  //! Latest sample [sec]
+  double latest_ = 0.0;
+
+  //! Maximum sample [sec]
+  double max_ = 0.0;
+
+  //! Deadline [sec]
+  double deadline_ = 0.0;
+
+  //! Number of samples over the deadline
+  size_t overrunNum_ = 0;
+};
+} // namespace LMC
@@ -0,0 +1,240 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <mc_rtc/Configuration.h>
+
+namespace LMC
+{
+/** \brief Recorder of trace spans exported in the Chrome trace event format.
+
+    Spans are recorded into a lock-free ring buffer owned by each thread, and are written to a JSON file by a
+    background thread. The file can be opened with chrome://tracing or Perfetto UI. When recording is disabled, a span
+    costs only one atomic load. Spans are dropped if the ring buffer is full. The buffer of an exited thread is reused
+    by a thread created later, so the memory does not grow with the number of threads created during recording. The
+    file is opened, written, and closed only by the background thread.
+*/
+class TraceRecorder
+{
+public:
+  /** \brief Configuration. */
+  struct Configuration
+  {
+    //! Whether to start recording when the controller is reset
+    bool enabled = false;
+
+    //! Path of output file
+    std::string filePath = "/tmp/LocomanipController-trace.json";
+
+    //! Period to write spans to the file [sec]
+    double flushPeriod = 0.01;
+
+    /** \brief Load mc_rtc configuration.
+        \param mcRtcConfig mc_rtc configuration
+    */
+    void load(const mc_rtc::Configuration & mcRtcConfig);
+  };
+
+  /** \brief Span recorded from its construction to its destruction. */
+  class ScopedSpan
+  {
+  public:
+    /** \brief Constructor.
+        \param name span name (must be a string literal or outlive the recording)
+    */
+    explicit ScopedSpan(const char * name) : name_(name), startTime_(instance().enabled() ? now() : -1) {}
+
+    /** \brief Destructor. */
+    ~ScopedSpan()
+    {
+      if(startTime_ >= 0)
+      {
+        instance().record(name_, startTime_, now());
+      }
+    }
+
+  protected:
+    //! Span name
+    const char * name_;
+
+    //! Start time [nsec] (negative if recording is disabled)
+    int64_t startTime_;
+  };
+
+public:
+  /** \brief Get the recorder shared by all threads. */
+  static TraceRecorder & instance();
+
+  /** \brief Get current time [nsec]. */
+  static inline int64_t now()
+  {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+  }
+
+  /** \brief Destructor. */
+  ~TraceRecorder();
+
+  /** \brief Start recording.
+      \param config configuration
+      \return whether recording is successfully started
+
+      The file is opened by the background thread, which stops recording if the file cannot be opened.
+  */
+  bool start(const Configuration & config);
+
+  /** \brief Stop recording, and wait for the remaining spans to be written and the file to be closed. */
+  void stop();
+
+  /** \brief Request to stop recording without waiting.
+
+      The remaining spans are written and the file is closed by the background thread. This does not block, so it can
+      be called from the control thread.
+  */
+  void requestStop();
+
+  /** \brief Whether recording is enabled. */
+  inline bool enabled() const noexcept
+  {
+    return enabled_.load(std::memory_order_relaxed);
+  }
+
+  /** \brief Get number of spans dropped because the ring buffer was full. */
+  inline size_t droppedNum() const noexcept
+  {
+    return droppedNum_.load(std::memory_order_relaxed);
+  }
+
+  /** \brief Record a span.
+      \param name span name
+      \param startTime start time [nsec]
+      \param endTime end time [nsec]
+  */
+  void record(const char * name, int64_t startTime, int64_t endTime);
+
+protected:
+  /** \brief Span. */
+  struct Event
+  {
+    //! Span name
+    const char * name = nullptr;
+
+    //! Start time [nsec]
+    int64_t startTime = 0;
+
+    //! End time [nsec]
+    int64_t endTime = 0;
+  };
+
+  /** \brief Ring buffer of spans written by one thread and read by the flushing thread. */
+  struct ThreadBuffer
+  {
+    //! Maximum number of spans in the buffer
+    static constexpr size_t capacity = 1 << 16;
+
+    //! Spans
+    std::array<Event, capacity> events;
+
+    //! Number of spans written by the owner thread
+    std::atomic<size_t> writeCount = 0;
+
+    //! Number of spans read by the flushing thread
+    std::atomic<size_t> readCount = 0;
+
+    //! Thread ID in the trace
+    int tid = 0;
+
+    //! Whether the buffer is owned by a running thread
+    std::atomic<bool> inUse = false;
+  };
+
+  /** \brief Owner of the buffer of a thread, which releases the buffer for reuse when the thread exits. */
+  struct ThreadBufferOwner
+  {
+    //! Buffer
+    std::shared_ptr<ThreadBuffer> buffer;
+
+    /** \brief Destructor. */
+    ~ThreadBufferOwner()
+    {
+      if(buffer)
+      {
+        buffer->inUse.store(false, std::memory_order_release);
+      }
+    }
+  };
+
+protected:
+  /** \brief Constructor. */
+  TraceRecorder() = default;
+
+  /** \brief Get the buffer of the current thread (acquired on the first call in each thread). */
+  ThreadBuffer & threadBuffer();
+
+  /** \brief Acquire a buffer released by an exited thread, or allocate a new one if there is none. */
+  std::shared_ptr<ThreadBuffer> acquireThreadBuffer();
+
+  /** \brief Loop of flushing thread. */
+  void flushLoop();
+
+  /** \brief Write the spans in all the buffers to the file. */
+  void flush();
+
+protected:
+  //! Whether recording is enabled
+  std::atomic<bool> enabled_ = false;
+
+  //! Number of spans dropped because the ring buffer was full
+  std::atomic<size_t> droppedNum_ = 0;
+
+  //! Buffers of all threads
+  std::vector<std::shared_ptr<ThreadBuffer>> threadBuffers_;
+
+  //! Mutex of threadBuffers_ (locked only when a thread records the first span and when flushing starts)
+  std::mutex threadBuffersMtx_;
+
+  //! Copy of threadBuffers_ used by the flushing thread so that the file is written without locking the mutex
+  std::vector<std::shared_ptr<ThreadBuffer>> flushBuffers_;
+
+  //! Configuration of the current recording
+  Configuration config_;
+
+  //! Output file stream
+  std::ofstream ofs_;
+
+  //! Whether no span has been written to the file
+  bool firstEvent_ = true;
+
+  //! Flushing thread
+  std::thread flushThread_;
+
+  //! Whether to stop flushing thread
+  std::atomic<bool> stopRequested_ = false;
+
+  //! Whether flushing thread is running (false after the file is closed)
+  std::atomic<bool> flushThreadRunning_ = false;
+
+  //! Mutex of start and stop
+  std::mutex startStopMtx_;
+};
+} // namespace LMC
+
+//! Helper macros for LMC_TRACE_SCOPE
+//! @{
+#define LMC_TRACE_CONCAT_IMPL(A, B) A##B
+#define LMC_TRACE_CONCAT(A, B) LMC_TRACE_CONCAT_IMPL(A, B)
+//! @}
+
+/** \brief Record a trace span of the current scope.
+    \param NAME span name (string literal)
+*/
+#define LMC_TRACE_SCOPE(NAME) LMC::TraceRecorder::ScopedSpan LMC_TRACE_CONCAT(lmcTraceSpan, __LINE__)(NAME)
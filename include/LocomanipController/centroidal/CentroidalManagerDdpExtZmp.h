@@ -0,0 +1,76 @@
+#pragma once
+
+#include <CCC/DdpZmp.h>
+
+#include <BaselineWalkingController/centroidal/CentroidalManagerDdpZmp.h>
+#include <LocomanipController/CentroidalManager.h>
+
+namespace LMC
+{
+/** \brief Centroidal manager with DDP.
+
+    Centroidal manager calculates the centroidal targets from the specified reference ZMP trajectory and sensor
+    measurements.
+
+    DDP plans the ext-ZMP instead of the ZMP, so that the time-varying scale and offset of ext-ZMP over the horizon are
+    taken into account in the CoM dynamics. The solution of the previous control cycle is used as the initial guess,
+    and the number of DDP iterations in each control cycle is limited by ddpMaxIter.
+*/
+class CentroidalManagerDdpExtZmp : public CentroidalManager, BWC::CentroidalManagerDdpZmp
+{
+public:
+  /** \brief Constructor.
+      \param ctlPtr pointer to controller
+      \param mcRtcConfig mc_rtc configuration
+   */
+  CentroidalManagerDdpExtZmp(LocomanipController * ctlPtr, const mc_rtc::Configuration & mcRtcConfig = {});
+
+  /** \brief Reset.
+
+      This method should be called once when controller is reset.
+  */
+  virtual void reset() override;
+
+  /** \brief Add entries to the logger. */
+  virtual void addToLogger(mc_rtc::Logger & logger) override;
+
+protected:
+  /** \brief Run MPC to plan centroidal trajectory.
+
+      This method calculates plannedZmp_ and plannedForceZ_ from mpcCom_ and mpcComVel_.
+   */
+  virtual void runMpc() override;
+
+  /** \brief Calculate planned CoM acceleration.
+
+      This method is overridden to support extended CoM-ZMP models (e.g., manipulation forces) in inherited classes.
+  */
+  virtual Eigen::Vector3d calcPlannedComAccel() const override;
+
+  /** \brief Calculate reference data of DDP with ext-ZMP.
+      \param t time [sec]
+  */
+  CCC::DdpZmp::RefData calcRefExtZmpData(double t) const;
+
+  /** \brief Update initial guess of control inputs from the solution of the previous control cycle.
+
+      The solution is shifted by the number of horizon steps elapsed since it was calculated. The control inputs
+      after the end of the previous solution are filled with the last one. If there is no previous solution, the
+      control inputs are initialized with the reference ext-ZMP and the robot weight.
+  */
+  void updateInitialUList();
+
+protected:
+  //! Number of steps in the horizon
+  size_t horizonSteps_ = 0;
+
+  //! Solution of control inputs (ext-ZMP x, y, and force z) in the previous control cycle
+  std::vector<CCC::DdpZmp::InputDimVector> lastUList_;
+
+  //! Time when lastUList_ is calculated [sec]
+  double lastUListTime_ = 0.0;
+
+  //! Initial guess of control inputs
+  std::vector<CCC::DdpZmp::InputDimVector> initialUList_;
+};
+} // namespace LMC
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <LocomanipController/CentroidalManager.h>
+
+namespace LMC
+{
+/** \brief Centroidal manager with foot-guided control.
+
+    Centroidal manager calculates the centroidal targets from the specified reference ZMP trajectory and sensor
+    measurements.
+
+    The reference ext-ZMP is evaluated only at the footstep switching times over the horizon and is interpolated
+    linearly between them, so that the reference DCM and the control input are obtained in closed form with a cost
+    proportional to the number of footsteps. The control input minimizes the deviation of the ext-ZMP from the
+    reference under the constraint that the DCM converges to the reference at the terminal switching time. See the
+    following paper for the foot-guided control:
+      X Xin, et al. Foot-Guided Agile Control of a Biped Robot Through ZMP Manipulation. IROS, 2020.
+*/
+class CentroidalManagerFootGuidedExtZmp : public CentroidalManager
+{
+public:
+  /** \brief Configuration. */
+  struct Configuration : public BWC::CentroidalManager::Configuration
+  {
+    //! Horizon duration [sec]
+    double horizonDuration = 2.0;
+
+    //! Minimum duration from the current time to the terminal switching time [sec]
+    double minTerminalDuration = 0.1;
+
+    //! Maximum number of knots in the horizon including the current time and the horizon end (used to preallocate
+    //! the buffers; the later switching times are ignored if exceeded)
+    int maxKnotNum = 64;
+
+    /** \brief Load mc_rtc configuration.
+        \param mcRtcConfig mc_rtc configuration
+    */
+    void load(const mc_rtc::Configuration & mcRtcConfig);
+  };
+
+public:
+  /** \brief Constructor.
+      \param ctlPtr pointer to controller
+      \param mcRtcConfig mc_rtc configuration
+   */
+  CentroidalManagerFootGuidedExtZmp(LocomanipController * ctlPtr, const mc_rtc::Configuration & mcRtcConfig = {});
+
+  /** \brief Reset.
+
+      This method should be called once when controller is reset.
+  */
+  virtual void reset() override;
+
+  /** \brief Add entries to the logger. */
+  virtual void addToLogger(mc_rtc::Logger & logger) override;
+
+  /** \brief Const accessor to the configuration. */
+  inline virtual const Configuration & config() const override
+  {
+    return config_;
+  }
+
+protected:
+  /** \brief Run MPC to plan centroidal trajectory.
+
+      This method calculates plannedZmp_ and plannedForceZ_ from mpcCom_ and mpcComVel_.
+   */
+  virtual void runMpc() override;
+
+  /** \brief Calculate planned CoM acceleration.
+
+      This method is overridden to support extended CoM-ZMP models (e.g., manipulation forces) in inherited classes.
+  */
+  virtual Eigen::Vector3d calcPlannedComAccel() const override;
+
+  /** \brief Add a knot of the reference ext-ZMP.
+      \param t time [sec]
+
+      The knot is skipped if it is not later than the last one.
+   */
+  void addKnot(double t);
+
+protected:
+  //! Configuration
+  Configuration config_;
+
+  //! Knots of the reference ext-ZMP (the first one is at the current time)
+  //! @{
+  std::vector<double> knotTimes_;
+  std::vector<Eigen::Vector2d> knotRefExtZmps_;
+  std::vector<Eigen::Vector2d> knotRefDcms_;
+  //! @}
+
+  //! Duration from the current time to the terminal switching time [sec]
+  double terminalDuration_ = 0.0;
+
+  //! Maximum number of knots (size of the preallocated buffers)
+  size_t maxKnotNum_ = 2;
+
+  //! Whether the warning of exceeding maxKnotNum has been printed
+  bool knotNumWarned_ = false;
+};
+} // namespace LMC
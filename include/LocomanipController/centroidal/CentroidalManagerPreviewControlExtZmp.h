@@ -1,7 +1,14 @@
 #pragma once
 
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include <CCC/PreviewControlZmp.h>
+
 #include <BaselineWalkingController/centroidal/CentroidalManagerPreviewControlZmp.h>
 #include <LocomanipController/CentroidalManager.h>
+#include <LocomanipController/ManipPhase.h>
 
 namespace LMC
 {
@@ -13,35 +20,64 @@ namespace LMC
 class CentroidalManagerPreviewControlExtZmp : public CentroidalManager, BWC::CentroidalManagerPreviewControlZmp
 {
 public:
-  /** \brief Data of ext-ZMP (i.e., ZMP with external forces).
-
+  /** \brief Configuration of asynchronous MPC.
 
-      The definition of ext-ZMP is given in the equation (9) of the paper:
-        M Murooka, et al. Humanoid loco-Manipulations pattern generation and stabilization control. RA-Letters, 2021
+      In the asynchronous MPC, the preview control is solved on a worker thread and the control thread uses the latest
+      plan without waiting for it. The reference ext-ZMP sequence is also calculated on the worker thread from a copy
+      of the reference data, because the reference functions of FootManager and ManipManager are rebuilt in place by
+      the control thread. The plan is shifted by the change of the reference ext-ZMP from the time of the request to
+      the current time.
   */
-  struct ExtZmpData
+  struct AsyncMpcConfiguration
   {
-    //! Scale
-    double scale = 1.0;
-
-    //! Offset
-    Eigen::Vector2d offset = Eigen::Vector2d::Zero();
-
-    /** \brief Convert conventional ZMP to ext-ZMP.
-        \param zmp ZMP
-     */
-    inline Eigen::Vector2d apply(const Eigen::Vector2d & zmp) const
-    {
-      return scale * zmp - offset;
-    }
-
-    /** \brief Convert ext-ZMP to conventional ZMP.
-        \param extZmp ext-ZMP
-     */
-    inline Eigen::Vector2d applyInv(const Eigen::Vector2d & extZmp) const
-    {
-      return (extZmp + offset) / scale;
-    }
+    //! Whether to enable asynchronous MPC
+    bool enabled = false;
+
+    //! Maximum age of the plan used in the control thread [sec] (MPC is run synchronously if the plan is older)
+    double maxStaleDuration = 0.01;
+
+    /** \brief Load mc_rtc configuration.
+        \param mcRtcConfig mc_rtc configuration
+    */
+    void load(const mc_rtc::Configuration & mcRtcConfig);
+  };
+
+  /** \brief Request of asynchronous MPC passed from the control thread to the worker thread. */
+  struct AsyncMpcRequest
+  {
+    //! Time of the control cycle [sec]
+    double t = 0.0;
+
+    //! Control timestep [sec]
+    double dt = 0.0;
+
+    //! Time step of the reference sequence [sec]
+    double horizonDt = 0.0;
+
+    //! Number of samples of the reference sequence
+    Eigen::Index horizonSize = 0;
+
+    //! Initial parameter of preview control
+    CCC::PreviewControlZmp::InitialParam initialParam;
+
+    //! Copy of the reference data to calculate the reference sequence
+    ExtZmpRefData refData;
+  };
+
+  /** \brief Result of asynchronous MPC passed from the worker thread to the control thread. */
+  struct AsyncMpcResult
+  {
+    //! Whether the result is valid
+    bool valid = false;
+
+    //! Time of the control cycle of the request [sec]
+    double t = 0.0;
+
+    //! Planned ext-ZMP
+    Eigen::Vector2d plannedExtZmp = Eigen::Vector2d::Zero();
+
+    //! Sequence of ext-ZMP data over the horizon from the time of the request
+    ExtZmpDataSeq extZmpDataSeq;
   };
 
 public:
@@ -51,6 +87,15 @@ public:
    */
   CentroidalManagerPreviewControlExtZmp(LocomanipController * ctlPtr, const mc_rtc::Configuration & mcRtcConfig = {});
 
+  /** \brief Destructor. */
+  ~CentroidalManagerPreviewControlExtZmp();
+
+  /** \brief Reset.
+
+      This method should be called once when controller is reset.
+  */
+  virtual void reset() override;
+
   /** \brief Add entries to the logger. */
   virtual void addToLogger(mc_rtc::Logger & logger) override;
 
@@ -70,11 +115,89 @@ protected:
   /** \brief Calculate reference data of MPC. */
   virtual Eigen::Vector2d calcRefData(double t) const override;
 
-  /** \brief Calculate data of ext-ZMP. */
-  ExtZmpData calcExtZmpData(double t) const;
+  /** \brief Solve MPC to plan centroidal trajectory in the current control cycle. */
+  void solveMpc();
+
+  /** \brief Whether to solve MPC in the current control cycle.
+
+      MPC is solved once every mpcDt_, and also when the hands holding the object change because it is not predicted
+      in the sequence of ext-ZMP data.
+  */
+  bool requireMpcSolve() const;
+
+  /** \brief Calculate the plan between MPC solves.
+
+      The planned ext-ZMP of the last solve is shifted by the change of the reference ext-ZMP, which is interpolated
+      from the sequence of ext-ZMP data calculated in the last solve.
+  */
+  void interpolateMpcPlan();
+
+  /** \brief Send request to asynchronous MPC and receive the latest result.
+      \param horizonSize number of samples of the reference sequence
+      \return whether the received plan is fresh enough to be used
+
+      When a new result is received, its sequence of ext-ZMP data replaces extZmpDataSeq_.
+  */
+  bool runAsyncMpc(Eigen::Index horizonSize);
+
+  /** \brief Start worker thread of asynchronous MPC. */
+  void startAsyncMpcThread();
+
+  /** \brief Stop worker thread of asynchronous MPC. */
+  void stopAsyncMpcThread();
+
+  /** \brief Loop of worker thread of asynchronous MPC. */
+  void asyncMpcLoop();
 
 protected:
-  //! Data of ext-ZMP
-  ExtZmpData extZmpData_;
+  //! Period of MPC solve [sec] (MPC is solved every control cycle if this is not greater than the control timestep)
+  double mpcDt_ = 0.0;
+
+  //! Whether MPC is solved in the current control cycle
+  bool mpcSolved_ = true;
+
+  //! Whether the plan of the last MPC solve is valid for interpolation
+  bool mpcPlanValid_ = false;
+
+  //! Plan of the last MPC solve
+  //! @{
+  double lastMpcTime_ = 0.0;
+  Eigen::Vector2d lastPlannedExtZmp_ = Eigen::Vector2d::Zero();
+  Eigen::Vector2d lastRefExtZmp_ = Eigen::Vector2d::Zero();
+  EnumArray<Hand, ManipPhaseLabel> lastMpcManipPhaseLabels_ = {{Hand::Left, ManipPhaseLabel::Free},
+                                                               {Hand::Right, ManipPhaseLabel::Free}};
+  //! @}
+
+  //! Configuration of asynchronous MPC
+  AsyncMpcConfiguration asyncMpcConfig_;
+
+  //! Whether MPC is run synchronously in the current control cycle
+  bool syncMpc_ = true;
+
+  //! Latest result of asynchronous MPC received in the control thread (its sequence of ext-ZMP data is moved to
+  //! extZmpDataSeq_)
+  AsyncMpcResult asyncMpcResult_;
+
+  //! Preview control used in the worker thread
+  std::shared_ptr<CCC::PreviewControlZmp> asyncPc_;
+
+  //! Worker thread of asynchronous MPC
+  std::thread asyncMpcThread_;
+
+  //! Request of asynchronous MPC (guarded by asyncMpcRequestMtx_)
+  //! @{
+  std::mutex asyncMpcRequestMtx_;
+  std::condition_variable asyncMpcRequestCv_;
+  AsyncMpcRequest asyncMpcRequest_;
+  bool asyncMpcRequested_ = false;
+  bool asyncMpcStopRequested_ = false;
+  //! @}
+
+  //! Double-buffered results of asynchronous MPC (the index of the latest result is guarded by asyncMpcResultMtx_)
+  //! @{
+  std::mutex asyncMpcResultMtx_;
+  std::array<AsyncMpcResult, 2> asyncMpcResults_;
+  size_t asyncMpcResultIdx_ = 0;
+  //! @}
 };
 } // namespace LMC
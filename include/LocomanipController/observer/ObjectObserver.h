@@ -0,0 +1,173 @@
+#pragma once
+
+#include <mc_observers/Observer.h>
+
+#include <geometry_msgs/PoseStamped.h>
+#include <geometry_msgs/TwistStamped.h>
+#include <ros/callback_queue.h>
+#include <ros/ros.h>
+
+#include <LocomanipController/LatestValueBuffer.h>
+
+namespace LMC
+{
+/** \brief Observer of object state.
+
+    The pose and velocity of the object are estimated from the pose and velocity topics by a Kalman filter with a
+    constant-velocity model, and are set to the real robot of the object. The velocity is estimated even if only the
+    pose topic is available. Each translational and rotational axis is filtered independently, so the computational
+    cost per control cycle is constant.
+
+    When this observer is used, the object topics of ManipManager should be empty so that the real object is not
+    overwritten.
+*/
+struct ObjectObserver : public mc_observers::Observer
+{
+public:
+  /** \brief Configuration. */
+  struct Configuration
+  {
+    //! Name of the object robot
+    std::string robot = "obj";
+
+    //! Object pose topic name (not subscribe if empty)
+    std::string poseTopic = "/object/pose";
+
+    //! Object velocity topic name (not subscribe if empty)
+    std::string velTopic = "/object/vel";
+
+    //! Process noise (power spectral density of acceleration) of translation [m^2/s^3] and rotation [rad^2/s^3]
+    //! @{
+    double linearAccelNoise = 10.0;
+    double angularAccelNoise = 10.0;
+    //! @}
+
+    //! Measurement noise variance of position [m^2] and orientation [rad^2]
+    //! @{
+    double linearPosNoise = 1e-6;
+    double angularPosNoise = 1e-5;
+    //! @}
+
+    //! Measurement noise variance of linear velocity [(m/s)^2] and angular velocity [(rad/s)^2]
+    //! @{
+    double linearVelNoise = 1e-4;
+    double angularVelNoise = 1e-4;
+    //! @}
+
+    /** \brief Load mc_rtc configuration. */
+    void load(const mc_rtc::Configuration & mcRtcConfig);
+  };
+
+  /** \brief Kalman filter with constant-velocity model for one axis.
+
+      The state is composed of position and velocity.
+  */
+  struct AxisFilter
+  {
+    //! State (position and velocity)
+    Eigen::Vector2d x = Eigen::Vector2d::Zero();
+
+    //! State covariance
+    Eigen::Matrix2d P = Eigen::Matrix2d::Identity();
+
+    /** \brief Reset.
+        \param pos position
+        \param posVar variance of position
+        \param velVar variance of velocity
+    */
+    void reset(double pos, double posVar, double velVar);
+
+    /** \brief Predict state after the timestep.
+        \param dt timestep [sec]
+        \param accelNoise power spectral density of acceleration
+    */
+    void predict(double dt, double accelNoise);
+
+    /** \brief Update state with measured position.
+        \param pos measured position
+        \param var measurement noise variance
+    */
+    void updatePos(double pos, double var);
+
+    /** \brief Update state with measured velocity.
+        \param vel measured velocity
+        \param var measurement noise variance
+    */
+    void updateVel(double vel, double var);
+  };
+
+public:
+  /** \brief Constructor.
+      \param type observer type
+      \param dt control timestep
+  */
+  ObjectObserver(const std::string & type, double dt);
+
+  /** \brief Configure observer. */
+  void configure(const mc_control::MCController & ctl, const mc_rtc::Configuration & mcRtcConfig) override;
+
+  /** \brief Reset observer. */
+  void reset(const mc_control::MCController & ctl) override;
+
+  /** \brief Run observer. */
+  bool run(const mc_control::MCController & ctl) override;
+
+  /** \brief Update the real robot of the object. */
+  void update(mc_control::MCController & ctl) override;
+
+protected:
+  /** \brief Add entries to the logger. */
+  void addToLogger(const mc_control::MCController & ctl,
+                   mc_rtc::Logger & logger,
+                   const std::string & category) override;
+
+  /** \brief Add entries to the GUI. */
+  void addToGUI(const mc_control::MCController & ctl,
+                mc_rtc::gui::StateBuilder & gui,
+                const std::vector<std::string> & category) override;
+
+  /** \brief Reset the filters with pose. */
+  void resetFilters(const sva::PTransformd & pose);
+
+  /** \brief ROS callback of object pose topic. */
+  void poseCallback(const geometry_msgs::PoseStamped::ConstPtr & poseStMsg);
+
+  /** \brief ROS callback of object velocity topic. */
+  void velCallback(const geometry_msgs::TwistStamped::ConstPtr & twistStMsg);
+
+protected:
+  //! Configuration
+  Configuration config_;
+
+  //! Filters of translation (x, y, z) and rotation (x, y, z) axes
+  //!
+  //! The positions of the rotation axes are the rotation vector from rot_ in the world frame.
+  std::array<AxisFilter, 6> filters_;
+
+  //! Estimated rotation matrix (i.e., the transpose of sva::PTransformd::rotation())
+  Eigen::Matrix3d rot_ = Eigen::Matrix3d::Identity();
+
+  //! Whether the filters are initialized with the first pose measurement
+  bool initialized_ = false;
+
+  //! Estimated pose
+  sva::PTransformd pose_ = sva::PTransformd::Identity();
+
+  //! Estimated velocity
+  sva::MotionVecd vel_ = sva::MotionVecd::Zero();
+
+  //! Latest pose received from ROS topic (position (x, y, z) and orientation quaternion (w, x, y, z))
+  LatestValueBuffer<std::array<double, 7>> poseBuffer_;
+
+  //! Latest velocity received from ROS topic (angular (x, y, z) and linear (x, y, z))
+  LatestValueBuffer<std::array<double, 6>> velBuffer_;
+
+  //! ROS variables
+  //! @{
+  std::unique_ptr<ros::NodeHandle> nh_;
+  ros::CallbackQueue callbackQueue_;
+  ros::Subscriber poseSub_;
+  ros::Subscriber velSub_;
+  //! @}
+};
+} // namespace LMC
@@ -21,6 +21,9 @@ protected:
   //! Phase
   int phase_ = 0;
 
+  //! Whether to wait for the footstep plan following the object in phase 10
+  bool waitFootstepPlan_ = false;
+
   //! End time of velocity mode [sec]
   double velModeEndTime_ = 0.0;
 };
@@ -1,10 +1,13 @@
 #pragma once
 
+#include <LocomanipController/LatestValueBuffer.h>
+#include <LocomanipController/ManipManager.h>
 #include <LocomanipController/State.h>
 
 #include <geometry_msgs/Twist.h>
 #include <ros/callback_queue.h>
 #include <ros/ros.h>
+#include <trajectory_msgs/MultiDOFJointTrajectory.h>
 
 namespace LMC
 {
@@ -25,6 +28,13 @@ protected:
   /** \brief ROS callback of twist topic. */
   void twistCallback(const geometry_msgs::Twist::ConstPtr & twistMsg);
 
+  /** \brief ROS callback of velocity profile topic.
+
+      The velocity of each point is given by the first element of velocities (linear x, linear y, angular z), and the
+      time of each point is given by the header stamp plus time_from_start.
+  */
+  void velProfileCallback(const trajectory_msgs::MultiDOFJointTrajectory::ConstPtr & trajMsg);
+
 protected:
   //! Relative target velocity of foot midpose (x [m/s], y [m/s], theta [rad/s])
   Eigen::Vector3d targetVel_ = Eigen::Vector3d::Zero();
@@ -32,11 +42,28 @@ protected:
   //! Scale to convert twist message to target velocity (x, y, theta)
   Eigen::Vector3d velScale_ = Eigen::Vector3d::Ones();
 
+  //! Latest twist received from ROS topic (linear x, linear y, angular z)
+  LatestValueBuffer<std::array<double, 3>> twistBuffer_;
+
+  //! Latest velocity profile received from ROS topic (times are ROS times [sec] and velocities are not scaled)
+  LatestValueBuffer<ManipManager::VelProfile> velProfileBuffer_;
+
+  //! Profile of relative target velocity (times are controller times [sec])
+  ManipManager::VelProfile velProfile_;
+
+  //! Whether to use velProfile_ instead of targetVel_ (i.e., whether the latest command is a velocity profile)
+  bool useVelProfile_ = false;
+
+  //! Whether velProfile_ needs to be set to ManipManager (i.e., whether it has been received since it was last set)
+  bool requireVelProfileUpdate_ = false;
+
   //! ROS variables
   //! @{
   std::unique_ptr<ros::NodeHandle> nh_;
   ros::CallbackQueue callbackQueue_;
   ros::Subscriber twistSub_;
+  ros::Subscriber velProfileSub_;
+  std::unique_ptr<ros::AsyncSpinner> spinner_;
   //! @}
 };
 } // namespace LMC
@@ -1,11 +1,111 @@
+#include <algorithm>
+#include <cmath>
+
+#include <mc_rtc/constants.h>
+
+#include <BaselineWalkingController/FootManager.h>
+
 #include <LocomanipController/CentroidalManager.h>
 #include <LocomanipController/LocomanipController.h>
+#include <LocomanipController/ManipManager.h>
+#include <LocomanipController/ManipPhase.h>
 
 using namespace LMC;
 
+void CentroidalManager::ExtZmpDataSeq::HandWrenchSeq::resize(Eigen::Index size)
+{
+  posX.resize(size);
+  posY.resize(size);
+  posZ.resize(size);
+  forceX.resize(size);
+  forceY.resize(size);
+  forceZ.resize(size);
+  momentX.resize(size);
+  momentY.resize(size);
+}
+
+void CentroidalManager::ExtZmpDataSeq::resize(Eigen::Index size)
+{
+  if(this->size() == size)
+  {
+    return;
+  }
+
+  refZmpX.resize(size);
+  refZmpY.resize(size);
+  refZmpZ.resize(size);
+  scale.resize(size);
+  offsetX.resize(size);
+  offsetY.resize(size);
+  for(auto & handWrenchSeq : handWrenchSeqs)
+  {
+    handWrenchSeq.resize(size);
+  }
+}
+
+Eigen::Index CentroidalManager::ExtZmpDataSeq::index(double t) const
+{
+  if(size() == 0 || dt <= 0.0)
+  {
+    return -1;
+  }
+
+  // Compare the time with the samples in units of the time step so as not to depend on how the caller accumulates the
+  // sample times
+  double pos = (t - startTime) / dt;
+  Eigen::Index idx = static_cast<Eigen::Index>(std::lround(pos));
+  constexpr double posThre = 1e-6;
+  if(idx < 0 || size() <= idx || std::abs(pos - static_cast<double>(idx)) > posThre)
+  {
+    return -1;
+  }
+  return idx;
+}
+
+CentroidalManager::ExtZmpData CentroidalManager::ExtZmpDataSeq::extZmpData(Eigen::Index idx) const
+{
+  ExtZmpData extZmpData;
+  extZmpData.scale = scale(idx);
+  extZmpData.offset << offsetX(idx), offsetY(idx);
+  return extZmpData;
+}
+
+void CentroidalManager::ExtZmpDataSeq::interpolate(double t,
+                                                   ExtZmpData & extZmpData,
+                                                   Eigen::Vector3d & refZmp) const
+{
+  double pos = std::clamp((t - startTime) / dt, 0.0, static_cast<double>(size() - 1));
+  Eigen::Index idx = static_cast<Eigen::Index>(pos);
+  Eigen::Index nextIdx = std::min(idx + 1, size() - 1);
+  double ratio = pos - static_cast<double>(idx);
+  auto interp = [&](const Eigen::ArrayXd & seq) { return (1.0 - ratio) * seq(idx) + ratio * seq(nextIdx); };
+
+  extZmpData.scale = interp(scale);
+  extZmpData.offset << interp(offsetX), interp(offsetY);
+  refZmp << interp(refZmpX), interp(refZmpY), interp(refZmpZ);
+}
+
+Eigen::Vector3d CentroidalManager::ExtZmpRefData::calcRefZmp(double t) const
+{
+  // Find the segment containing the time (the reference ZMP is held outside the knots)
+  auto nextIt = std::upper_bound(refZmpKnotTimes.begin(), refZmpKnotTimes.end(), t);
+  if(nextIt == refZmpKnotTimes.begin())
+  {
+    return refZmpKnots.front();
+  }
+  if(nextIt == refZmpKnotTimes.end())
+  {
+    return refZmpKnots.back();
+  }
+  size_t nextIdx = static_cast<size_t>(nextIt - refZmpKnotTimes.begin());
+  double ratio = (t - refZmpKnotTimes[nextIdx - 1]) / (refZmpKnotTimes[nextIdx] - refZmpKnotTimes[nextIdx - 1]);
+  return (1.0 - ratio) * refZmpKnots[nextIdx - 1] + ratio * refZmpKnots[nextIdx];
+}
+
 CentroidalManager::CentroidalManager(LocomanipController * ctlPtr, const mc_rtc::Configuration & mcRtcConfig)
 : BWC::CentroidalManager(ctlPtr, mcRtcConfig)
 {
+  mcRtcConfig("extZmpLogDecimation", extZmpLogDecimation_);
 }
 
 const LocomanipController & CentroidalManager::ctl() const
@@ -17,3 +117,247 @@ LocomanipController & CentroidalManager::ctl()
 {
   return *static_cast<LocomanipController *>(ctlPtr_);
 }
+
+CentroidalManager::ExtZmpData CentroidalManager::calcExtZmpData(double t) const
+{
+  ExtZmpData extZmpData;
+  extZmpData.scale = 0.0;
+  extZmpData.offset.setZero();
+
+  // Reuse the references of the current control cycle instead of evaluating the interpolation functions again
+  const auto & refSnapshot = ctl().manipManager_->refSnapshot();
+  bool useRefSnapshot = (t == refSnapshot.t);
+
+  Eigen::Vector3d refZmp = ctl().footManager_->calcRefZmp(t);
+  for(const auto & hand : Hands::Both)
+  {
+    if(refSnapshot.manipPhaseLabels.at(hand) != ManipPhaseLabel::Hold)
+    {
+      continue;
+    }
+
+    // Assume that objPoseOffset is constant
+    sva::PTransformd objPose = useRefSnapshot ? refSnapshot.objPose
+                                              : refSnapshot.objPoseOffset * ctl().manipManager_->calcRefObjPose(t);
+    sva::PTransformd handPose = ctl().manipManager_->config().objToHandTranss.at(hand) * objPose;
+    // Represent the hand wrench in the frame whose position is same with the hand frame and orientation is same with
+    // the world frame
+    sva::ForceVecd handWrenchLocal =
+        useRefSnapshot ? refSnapshot.handWrenches.at(hand) : ctl().manipManager_->calcRefHandWrench(hand, t);
+    sva::PTransformd handRotTrans(Eigen::Matrix3d(handPose.rotation()));
+    sva::ForceVecd handWrench = handRotTrans.transMul(handWrenchLocal);
+
+    const auto & pos = handPose.translation();
+    const auto & force = handWrench.force();
+    const auto & moment = handWrench.moment();
+
+    // Equation (3) in the paper:
+    //   M Murooka, et al. Humanoid loco-Manipulations pattern generation and stabilization control. RA-Letters, 2021
+    extZmpData.scale -= force.z();
+    extZmpData.offset.x() += (pos.z() - refZmp.z()) * force.x() - pos.x() * force.z() + moment.y();
+    extZmpData.offset.y() += (pos.z() - refZmp.z()) * force.y() - pos.y() * force.z() - moment.x();
+  }
+
+  // Ignore the effect of CoM Z acceleration
+  double mg = robotMass_ * mc_rtc::constants::gravity.z();
+  extZmpData.scale /= mg;
+  extZmpData.scale += 1.0;
+  extZmpData.offset /= mg;
+
+  return extZmpData;
+}
+
+namespace
+{
+/** \brief Calculate sequence of ext-ZMP data in one pass.
+    \param startTime time of the first sample [sec]
+    \param dt time step between samples [sec]
+    \param size number of samples
+    \param robotMass robot mass [kg]
+    \param manipPhaseLabels manipulation phase labels
+    \param objToHandTranss transformations from object to hands
+    \param refZmpFunc function returning the reference ZMP for the time
+    \param objPoseFunc function returning the object pose (including the offset pose) for the time
+    \param handWrenchFunc function returning the reference hand wrench in the hand frame for the hand and time
+    \param extZmpDataSeq sequence of ext-ZMP data to be filled
+*/
+template<class RefZmpFunc, class ObjPoseFunc, class HandWrenchFunc>
+void calcExtZmpDataSeqImpl(double startTime,
+                           double dt,
+                           Eigen::Index size,
+                           double robotMass,
+                           const EnumArray<Hand, ManipPhaseLabel> & manipPhaseLabels,
+                           const EnumArray<Hand, sva::PTransformd> & objToHandTranss,
+                           const RefZmpFunc & refZmpFunc,
+                           const ObjPoseFunc & objPoseFunc,
+                           const HandWrenchFunc & handWrenchFunc,
+                           CentroidalManager::ExtZmpDataSeq & extZmpDataSeq)
+{
+  extZmpDataSeq.startTime = startTime;
+  extZmpDataSeq.dt = dt;
+  extZmpDataSeq.resize(size);
+
+  // Sample the reference ZMP
+  for(Eigen::Index i = 0; i < size; i++)
+  {
+    Eigen::Vector3d refZmp = refZmpFunc(startTime + static_cast<double>(i) * dt);
+    extZmpDataSeq.refZmpX(i) = refZmp.x();
+    extZmpDataSeq.refZmpY(i) = refZmp.y();
+    extZmpDataSeq.refZmpZ(i) = refZmp.z();
+  }
+
+  extZmpDataSeq.scale.setZero();
+  extZmpDataSeq.offsetX.setZero();
+  extZmpDataSeq.offsetY.setZero();
+
+  std::array<Hand, 2> holdHands;
+  size_t holdHandNum = 0;
+  for(const auto & hand : Hands::Both)
+  {
+    if(manipPhaseLabels.at(hand) == ManipPhaseLabel::Hold)
+    {
+      holdHands[holdHandNum++] = hand;
+    }
+  }
+
+  if(holdHandNum > 0)
+  {
+    // Sample the hand poses and wrenches (the object pose is evaluated once per sample for both hands)
+    for(Eigen::Index i = 0; i < size; i++)
+    {
+      double t = startTime + static_cast<double>(i) * dt;
+      sva::PTransformd objPose = objPoseFunc(t);
+      for(size_t j = 0; j < holdHandNum; j++)
+      {
+        const Hand & hand = holdHands[j];
+        auto & handWrenchSeq = extZmpDataSeq.handWrenchSeqs.at(hand);
+
+        sva::PTransformd handPose = objToHandTranss.at(hand) * objPose;
+        // Represent the hand wrench in the frame whose position is same with the hand frame and orientation is same
+        // with the world frame
+        sva::PTransformd handRotTrans(Eigen::Matrix3d(handPose.rotation()));
+        sva::ForceVecd handWrench = handRotTrans.transMul(handWrenchFunc(hand, t));
+
+        handWrenchSeq.posX(i) = handPose.translation().x();
+        handWrenchSeq.posY(i) = handPose.translation().y();
+        handWrenchSeq.posZ(i) = handPose.translation().z();
+        handWrenchSeq.forceX(i) = handWrench.force().x();
+        handWrenchSeq.forceY(i) = handWrench.force().y();
+        handWrenchSeq.forceZ(i) = handWrench.force().z();
+        handWrenchSeq.momentX(i) = handWrench.moment().x();
+        handWrenchSeq.momentY(i) = handWrench.moment().y();
+      }
+    }
+
+    // Accumulate the hand forces effects with array operations
+    // Equation (3) in the paper:
+    //   M Murooka, et al. Humanoid loco-Manipulations pattern generation and stabilization control. RA-Letters, 2021
+    for(size_t j = 0; j < holdHandNum; j++)
+    {
+      const auto & handWrenchSeq = extZmpDataSeq.handWrenchSeqs.at(holdHands[j]);
+      extZmpDataSeq.scale -= handWrenchSeq.forceZ;
+      extZmpDataSeq.offsetX += (handWrenchSeq.posZ - extZmpDataSeq.refZmpZ) * handWrenchSeq.forceX
+                               - handWrenchSeq.posX * handWrenchSeq.forceZ + handWrenchSeq.momentY;
+      extZmpDataSeq.offsetY += (handWrenchSeq.posZ - extZmpDataSeq.refZmpZ) * handWrenchSeq.forceY
+                               - handWrenchSeq.posY * handWrenchSeq.forceZ - handWrenchSeq.momentX;
+    }
+  }
+
+  // Ignore the effect of CoM Z acceleration
+  double mg = robotMass * mc_rtc::constants::gravity.z();
+  extZmpDataSeq.scale = extZmpDataSeq.scale / mg + 1.0;
+  extZmpDataSeq.offsetX /= mg;
+  extZmpDataSeq.offsetY /= mg;
+}
+} // namespace
+
+void CentroidalManager::calcExtZmpDataSeq(double startTime,
+                                          double dt,
+                                          Eigen::Index size,
+                                          ExtZmpDataSeq & extZmpDataSeq) const
+{
+  const auto & manipManager = *ctl().manipManager_;
+  const auto & refSnapshot = manipManager.refSnapshot();
+
+  // Reuse the references of the current control cycle instead of evaluating the interpolation functions again
+  // Assume that objPoseOffset is constant
+  auto refZmpFunc = [&](double t) { return ctl().footManager_->calcRefZmp(t); };
+  auto objPoseFunc = [&](double t) -> sva::PTransformd {
+    return t == refSnapshot.t ? refSnapshot.objPose : refSnapshot.objPoseOffset * manipManager.calcRefObjPose(t);
+  };
+  auto handWrenchFunc = [&](const Hand & hand, double t) -> sva::ForceVecd {
+    return t == refSnapshot.t ? refSnapshot.handWrenches.at(hand) : manipManager.calcRefHandWrench(hand, t);
+  };
+  calcExtZmpDataSeqImpl(startTime, dt, size, robotMass_, refSnapshot.manipPhaseLabels,
+                        manipManager.config().objToHandTranss, refZmpFunc, objPoseFunc, handWrenchFunc,
+                        extZmpDataSeq);
+}
+
+void CentroidalManager::calcExtZmpDataSeq(const ExtZmpRefData & refData,
+                                          double startTime,
+                                          double dt,
+                                          Eigen::Index size,
+                                          ExtZmpDataSeq & extZmpDataSeq) const
+{
+  const auto & manipRefFuncs = refData.manipRefFuncs;
+
+  // Assume that objPoseOffset is constant
+  auto refZmpFunc = [&](double t) { return refData.calcRefZmp(t); };
+  auto objPoseFunc = [&](double t) { return manipRefFuncs.objPoseOffset * manipRefFuncs.calcRefObjPose(t); };
+  auto handWrenchFunc = [&](const Hand & hand, double t) { return manipRefFuncs.calcRefHandWrench(hand, t); };
+  calcExtZmpDataSeqImpl(startTime, dt, size, robotMass_, manipRefFuncs.manipPhaseLabels,
+                        manipRefFuncs.objToHandTranss, refZmpFunc, objPoseFunc, handWrenchFunc, extZmpDataSeq);
+}
+
+void CentroidalManager::copyExtZmpRefData(double startTime, double endTime, ExtZmpRefData & refData) const
+{
+  // Copy the reference ZMP at the current time, the footstep switching times, and the horizon end
+  refData.refZmpKnotTimes.clear();
+  refData.refZmpKnots.clear();
+  auto addKnot = [&](double t) {
+    if(!refData.refZmpKnotTimes.empty() && t <= refData.refZmpKnotTimes.back())
+    {
+      return;
+    }
+    refData.refZmpKnotTimes.push_back(t);
+    refData.refZmpKnots.push_back(ctl().footManager_->calcRefZmp(t));
+  };
+  addKnot(startTime);
+  for(const auto & footstep : ctl().footManager_->footstepQueue())
+  {
+    if(footstep.transitStartTime >= endTime)
+    {
+      break;
+    }
+    for(double switchTime :
+        {footstep.transitStartTime, footstep.swingStartTime, footstep.swingEndTime, footstep.transitEndTime})
+    {
+      if(startTime < switchTime && switchTime < endTime)
+      {
+        addKnot(switchTime);
+      }
+    }
+  }
+  addKnot(endTime);
+
+  ctl().manipManager_->copyRefFuncs(refData.manipRefFuncs);
+}
+
+void CentroidalManager::resetExtZmpLog()
+{
+  extZmpLogDecimator_.reset(config().name + "_ExtZmp", extZmpLogDecimation_, ctl().dt());
+}
+
+void CentroidalManager::updateExtZmpLog()
+{
+  extZmpLogDecimator_.update(ctl().t());
+}
+
+void CentroidalManager::addExtZmpToLogger(mc_rtc::Logger & logger, const std::string & name)
+{
+  // Ext-ZMP data is written to a separate log file at a lower rate if extZmpLogDecimation is greater than 1
+  mc_rtc::Logger & extZmpLogger = extZmpLogDecimator_.logger(logger);
+  extZmpLogger.addLogEntry(name + "_ExtZmp_scale", this, [this]() { return extZmpData_.scale; });
+  extZmpLogger.addLogEntry(name + "_ExtZmp_offset", this,
+                           [this]() -> const Eigen::Vector2d & { return extZmpData_.offset; });
+}
@@ -1,3 +1,6 @@
+#include <mc_rtc/gui/Button.h>
+#include <mc_rtc/gui/Checkbox.h>
+#include <mc_rtc/gui/Label.h>
 #include <mc_tasks/ImpedanceTask.h>
 #include <mc_tasks/MetaTaskLoader.h>
 
@@ -5,6 +8,9 @@
 
 #include <LocomanipController/LocomanipController.h>
 #include <LocomanipController/ManipManager.h>
+#include <LocomanipController/PlanPublisher.h>
+#include <LocomanipController/centroidal/CentroidalManagerDdpExtZmp.h>
+#include <LocomanipController/centroidal/CentroidalManagerFootGuidedExtZmp.h>
 #include <LocomanipController/centroidal/CentroidalManagerPreviewControlExtZmp.h>
 
 using namespace LMC;
@@ -21,8 +27,8 @@ LocomanipController::LocomanipController(mc_rbdyn::RobotModulePtr rm,
     for(const auto & handTaskConfig : config()("HandTaskList"))
     {
       Hand hand = strToHand(handTaskConfig("hand"));
-      handTasks_.emplace(hand,
-                         mc_tasks::MetaTaskLoader::load<mc_tasks::force::ImpedanceTask>(solver(), handTaskConfig));
+      handTasks_.at(hand) =
+          mc_tasks::MetaTaskLoader::load<mc_tasks::force::ImpedanceTask>(solver(), handTaskConfig);
       handTasks_.at(hand)->name("HandTask_" + std::to_string(hand));
     }
   }
@@ -42,6 +48,15 @@ LocomanipController::LocomanipController(mc_rbdyn::RobotModulePtr rm,
         centroidalManager_ =
             std::make_shared<CentroidalManagerPreviewControlExtZmp>(this, config()("CentroidalManager"));
       }
+      else if(centroidalManagerMethod == "DdpExtZmp")
+      {
+        centroidalManager_ = std::make_shared<CentroidalManagerDdpExtZmp>(this, config()("CentroidalManager"));
+      }
+      else if(centroidalManagerMethod == "FootGuidedExtZmp")
+      {
+        centroidalManager_ =
+            std::make_shared<CentroidalManagerFootGuidedExtZmp>(this, config()("CentroidalManager"));
+      }
       else
       {
         if(!allowEmptyManager)
@@ -64,6 +79,14 @@ LocomanipController::LocomanipController(mc_rbdyn::RobotModulePtr rm,
   {
     mc_rtc::log::warning("[LocomanipController] ManipManager configuration is missing.");
   }
+  if(config().has("TraceRecorder"))
+  {
+    traceRecorderConfig_.load(config()("TraceRecorder"));
+  }
+  if(config().has("PlanPublisher"))
+  {
+    planPublisher_ = std::make_shared<PlanPublisher>(this, config()("PlanPublisher"));
+  }
 
   mc_rtc::log::success("[LocomanipController] Constructed.");
 }
@@ -72,21 +95,76 @@ void LocomanipController::reset(const mc_control::ControllerResetData & resetDat
 {
   BaselineWalkingController::reset(resetData);
 
+  // Setup timing histograms
+  resetRunTimings();
+  runTimings_.footManager.addToLogger(logger(), "Timing_footManager", &runTimings_);
+  runTimings_.manipManager.addToLogger(logger(), "Timing_manipManager", &runTimings_);
+  runTimings_.centroidalManager.addToLogger(logger(), "Timing_centroidalManager", &runTimings_);
+  runTimings_.fsm.addToLogger(logger(), "Timing_fsm", &runTimings_);
+  runTimings_.total.addToLogger(logger(), "Timing_total", &runTimings_);
+  gui()->addElement({name(), "Timing"}, mc_rtc::gui::Button("Reset", [this]() { resetRunTimings(); }));
+  runTimings_.footManager.addToGUI(*gui(), {name(), "Timing"}, "footManager");
+  runTimings_.manipManager.addToGUI(*gui(), {name(), "Timing"}, "manipManager");
+  runTimings_.centroidalManager.addToGUI(*gui(), {name(), "Timing"}, "centroidalManager");
+  runTimings_.fsm.addToGUI(*gui(), {name(), "Timing"}, "fsm");
+  runTimings_.total.addToGUI(*gui(), {name(), "Timing"}, "total");
+
+  // Setup trace recorder
+  if(traceRecorderConfig_.enabled)
+  {
+    TraceRecorder::instance().start(traceRecorderConfig_);
+  }
+  gui()->addElement(
+      {name(), "Trace"}, mc_rtc::gui::Label("filePath", [this]() { return traceRecorderConfig_.filePath; }),
+      mc_rtc::gui::Checkbox(
+          "recording", []() { return TraceRecorder::instance().enabled(); },
+          [this]() {
+            // Do not wait for the file to be closed in the control thread
+            if(TraceRecorder::instance().enabled())
+            {
+              TraceRecorder::instance().requestStop();
+            }
+            else
+            {
+              TraceRecorder::instance().start(traceRecorderConfig_);
+            }
+          }),
+      mc_rtc::gui::Label("droppedNum", []() { return std::to_string(TraceRecorder::instance().droppedNum()); }));
+
   mc_rtc::log::success("[LocomanipController] Reset.");
 }
 
 bool LocomanipController::run()
 {
+  TimingHistogram::ScopedTimer totalTimer(runTimings_.total);
+
   t_ += dt();
 
   if(enableManagerUpdate_)
   {
     // Update managers
-    footManager_->update();
-    manipManager_->update();
-    centroidalManager_->update();
+    {
+      TimingHistogram::ScopedTimer timer(runTimings_.footManager);
+      footManager_->update();
+    }
+    {
+      TimingHistogram::ScopedTimer timer(runTimings_.manipManager);
+      manipManager_->update();
+    }
+    {
+      TimingHistogram::ScopedTimer timer(runTimings_.centroidalManager);
+      centroidalManager_->update();
+    }
+
+    // Copy the plan to be published
+    if(planPublisher_)
+    {
+      planPublisher_->update();
+    }
   }
 
+  TimingHistogram::ScopedTimer fsmTimer(runTimings_.fsm);
+  LMC_TRACE_SCOPE("LocomanipController::fsm");
   return mc_control::fsm::Controller::run();
 }
 
@@ -100,6 +178,27 @@ void LocomanipController::stop()
 
   // Clean up managers
   manipManager_->stop();
+  if(planPublisher_)
+  {
+    planPublisher_->stop();
+  }
+
+  // Clean up timing histograms
+  logger().removeLogEntries(&runTimings_);
+  gui()->removeCategory({name(), "Timing"});
+
+  // Clean up trace recorder
+  TraceRecorder::instance().stop();
+  gui()->removeCategory({name(), "Trace"});
 
   BaselineWalkingController::stop();
 }
+
+void LocomanipController::resetRunTimings()
+{
+  runTimings_.footManager.reset(dt());
+  runTimings_.manipManager.reset(dt());
+  runTimings_.centroidalManager.reset(dt());
+  runTimings_.fsm.reset(dt());
+  runTimings_.total.reset(dt());
+}
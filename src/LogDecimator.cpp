@@ -0,0 +1,73 @@
+#include <algorithm>
+
+#include <mc_rtc/logging.h>
+
+#include <LocomanipController/LogDecimator.h>
+
+using namespace LMC;
+
+void LogDecimator::reset(const std::string & name, int decimation, double dt)
+{
+  name_ = name;
+  decimation_ = std::max(decimation, 1);
+  dt_ = dt;
+  // Sample in the first control cycle
+  count_ = decimation_ - 1;
+
+  mainLogger_ = nullptr;
+  opened_ = false;
+  if(decimation_ > 1)
+  {
+    // The entries are written from the logging thread of mc_rtc::Logger
+    logger_ = std::make_unique<mc_rtc::Logger>(mc_rtc::Logger::Policy::THREADED, "", "");
+  }
+  else
+  {
+    logger_.reset();
+  }
+}
+
+mc_rtc::Logger & LogDecimator::logger(mc_rtc::Logger & mainLogger)
+{
+  mainLogger_ = &mainLogger;
+  return logger_ ? *logger_ : mainLogger;
+}
+
+bool LogDecimator::update(double t)
+{
+  if(++count_ < decimation_)
+  {
+    return false;
+  }
+  count_ = 0;
+
+  if(logger_ && mainLogger_ && (opened_ || open(t)))
+  {
+    logger_->log();
+  }
+
+  return true;
+}
+
+bool LogDecimator::open(double t)
+{
+  // The main log file is not opened if logging is disabled or not started yet
+  std::string filePath = mainLogger_->path();
+  if(filePath.empty())
+  {
+    return false;
+  }
+
+  const std::string ext = ".bin";
+  if(filePath.size() >= ext.size() && filePath.compare(filePath.size() - ext.size(), ext.size(), ext) == 0)
+  {
+    filePath.resize(filePath.size() - ext.size());
+  }
+  filePath += "-" + name_ + ext;
+
+  logger_->open(filePath, decimation_ * dt_, t);
+  opened_ = true;
+  mc_rtc::log::info("[LogDecimator] Log {} at {} Hz to {}.", name_, 1.0 / (decimation_ * dt_), filePath);
+
+  return true;
+}
@@ -1,3 +1,5 @@
+#include <algorithm>
+
 #include <mc_rtc/gui/ArrayInput.h>
 #include <mc_rtc/gui/Checkbox.h>
 #include <mc_rtc/gui/Label.h>
@@ -11,16 +13,33 @@
 #include <LocomanipController/ManipManager.h>
 #include <LocomanipController/ManipPhase.h>
 #include <LocomanipController/MathUtils.h>
+#include <LocomanipController/TraceRecorder.h>
 
 using namespace LMC;
 
+void Waypoint::Options::load(const mc_rtc::Configuration & mcRtcConfig)
+{
+  mcRtcConfig("accelDuration", accelDuration);
+}
+
 void ManipManager::Configuration::load(const mc_rtc::Configuration & mcRtcConfig)
 {
   mcRtcConfig("name", name);
   mcRtcConfig("objPoseInterpolator", objPoseInterpolator);
   mcRtcConfig("objHorizon", objHorizon);
+  mcRtcConfig("incrementalObjTraj", incrementalObjTraj);
+  if(incrementalObjTraj && objPoseInterpolator != "BangBang")
+  {
+    mc_rtc::log::warning("[ManipManager] incrementalObjTraj is available only with the BangBang objPoseInterpolator, "
+                         "so it is disabled for {}.",
+                         objPoseInterpolator);
+    incrementalObjTraj = false;
+  }
   mcRtcConfig("objPoseTopic", objPoseTopic);
   mcRtcConfig("objVelTopic", objVelTopic);
+  mcRtcConfig("useAsyncSpinner", useAsyncSpinner);
+  mcRtcConfig("objLatencyCompensation", objLatencyCompensation);
+  mcRtcConfig("maxObjExtrapolationDuration", maxObjExtrapolationDuration);
   mcRtcConfig("handTaskStiffness", handTaskStiffness);
   mcRtcConfig("preReachDuration", preReachDuration);
   mcRtcConfig("reachDuration", reachDuration);
@@ -49,25 +68,72 @@ void ManipManager::Configuration::load(const mc_rtc::Configuration & mcRtcConfig
   mcRtcConfig("objToFootMidTrans", objToFootMidTrans);
   mcRtcConfig("footstepDuration", footstepDuration);
   mcRtcConfig("doubleSupportRatio", doubleSupportRatio);
+  mcRtcConfig("footstepQueueSize", footstepQueueSize);
+  mcRtcConfig("asyncFootstepPlan", asyncFootstepPlan);
 
   mcRtcConfig("handForceArrowScale", handForceArrowScale);
+  mcRtcConfig("markerUpdateDecimation", markerUpdateDecimation);
+  mcRtcConfig("maxWaypointMarkerNum", maxWaypointMarkerNum);
+  mcRtcConfig("objStateLogDecimation", objStateLogDecimation);
 }
 
 void ManipManager::VelModeData::Configuration::load(const mc_rtc::Configuration & mcRtcConfig)
 {
   mcRtcConfig("nonholonomicObjectMotion", nonholonomicObjectMotion);
+  mcRtcConfig("feasibleStepSearchNum", feasibleStepSearchNum);
+  mcRtcConfig("maxPreviewStepNum", maxPreviewStepNum);
 }
 
 void ManipManager::VelModeData::reset(bool enabled, const sva::PTransformd & currentObjPose)
 {
   enabled_ = enabled;
   targetVel_.setZero();
+  velProfile_.pointNum = 0;
   frontFootstep_ = nullptr;
   frontWaypointPose_ = currentObjPose;
+  prevWaypointPose_ = currentObjPose;
   objDeltaTrans_.setZero();
+  previewWaypointNum_ = 0;
+  requirePreview_ = false;
 }
 
-ManipManager::ManipManager(LocomanipController * ctlPtr, const mc_rtc::Configuration & mcRtcConfig) : ctlPtr_(ctlPtr)
+Eigen::Vector3d ManipManager::VelProfile::velAt(double t) const
+{
+  if(pointNum == 0 || endTime() <= t)
+  {
+    return Eigen::Vector3d::Zero();
+  }
+  size_t idx = 0;
+  while(idx + 2 < pointNum && times[idx + 1] <= t)
+  {
+    idx++;
+  }
+  return vel(idx);
+}
+
+bool ManipManager::VelProfile::validate() const
+{
+  if(pointNum < 2 || pointNum > maxPointNum)
+  {
+    mc_rtc::log::error("[ManipManager] Invalid number of points in the velocity profile (the last point gives the end "
+                       "time): {}",
+                       pointNum);
+    return false;
+  }
+  for(size_t i = 1; i < pointNum; i++)
+  {
+    if(times[i] < times[i - 1])
+    {
+      mc_rtc::log::error("[ManipManager] Times in the velocity profile must be in ascending order: {} < {}", times[i],
+                         times[i - 1]);
+      return false;
+    }
+  }
+  return true;
+}
+
+ManipManager::ManipManager(LocomanipController * ctlPtr, const mc_rtc::Configuration & mcRtcConfig)
+: ctlPtr_(ctlPtr), manipPhases_({ManipPhase::Machine(Hand::Left, this), ManipPhase::Machine(Hand::Right, this)})
 {
   config_.load(mcRtcConfig);
 
@@ -77,6 +143,11 @@ ManipManager::ManipManager(LocomanipController * ctlPtr, const mc_rtc::Configura
   }
 }
 
+ManipManager::~ManipManager()
+{
+  stopFootstepPlanThread();
+}
+
 void ManipManager::reset()
 {
   // Setup ROS
@@ -100,8 +171,29 @@ void ManipManager::reset()
       objVelSub_ =
           nh_->subscribe<geometry_msgs::TwistStamped>(config_.objVelTopic, 1, &ManipManager::objVelCallback, this);
     }
+
+    if(config_.useAsyncSpinner)
+    {
+      spinner_ = std::make_unique<ros::AsyncSpinner>(1, &callbackQueue_);
+      spinner_->start();
+    }
   }
 
+  objPoseHistory_.clear();
+  objVelReceived_ = false;
+  objPoseLatency_ = 0.0;
+
+  updateTimings_.realObj.reset(ctl().dt());
+  updateTimings_.velMode.reset(ctl().dt());
+  updateTimings_.objTraj.reset(ctl().dt());
+  updateTimings_.handTraj.reset(ctl().dt());
+  updateTimings_.footstep.reset(ctl().dt());
+  updateTimings_.markerState.reset(ctl().dt());
+
+  objStateLogDecimator_.reset(config_.name + "_objState", config_.objStateLogDecimation, ctl().dt());
+
+  stopFootstepPlanThread();
+
   objPoseOffsetFunc_.reset();
   objPoseOffset_ = sva::PTransformd::Identity();
 
@@ -109,10 +201,15 @@ void ManipManager::reset()
   if(config_.objPoseInterpolator == "Cubic")
   {
     objPoseFunc_ = std::make_shared<TrajColl::CubicInterpolator<sva::PTransformd, sva::MotionVecd>>();
+    footstepObjPoseFunc_ = std::make_shared<TrajColl::CubicInterpolator<sva::PTransformd, sva::MotionVecd>>();
+    footstepPlanObjPoseFunc_ = std::make_shared<TrajColl::CubicInterpolator<sva::PTransformd, sva::MotionVecd>>();
   }
   else if(config_.objPoseInterpolator == "BangBang")
   {
     objPoseFunc_ = std::make_shared<TrajColl::BangBangInterpolator<sva::PTransformd, sva::MotionVecd>>();
+    footstepObjPoseFunc_ = std::make_shared<TrajColl::BangBangInterpolator<sva::PTransformd, sva::MotionVecd>>();
+    footstepPlanObjPoseFunc_ =
+        std::make_shared<TrajColl::BangBangInterpolator<sva::PTransformd, sva::MotionVecd>>();
   }
   else
   {
@@ -126,9 +223,9 @@ void ManipManager::reset()
 
   for(const auto & hand : Hands::Both)
   {
-    manipPhases_.emplace(hand, std::make_shared<ManipPhase::Free>(hand, this));
+    manipPhases_.at(hand).start(ManipPhaseLabel::Free);
 
-    handWrenchFuncs_.emplace(hand, std::make_shared<TrajColl::CubicInterpolator<sva::ForceVecd>>());
+    handWrenchFuncs_.at(hand) = std::make_shared<TrajColl::CubicInterpolator<sva::ForceVecd>>();
     handWrenchFuncs_.at(hand)->clearPoints();
     handWrenchFuncs_.at(hand)->appendPoint(std::make_pair(ctl().t(), sva::ForceVecd::Zero()));
     handWrenchFuncs_.at(hand)->appendPoint(std::make_pair(interpMaxTime_, sva::ForceVecd::Zero()));
@@ -137,13 +234,30 @@ void ManipManager::reset()
 
   requireImpGainUpdate_ = true;
 
+  requireObjPoseFuncUpdate_ = true;
+
   requireFootstepFollowingObj_ = false;
+  footstepGenState_.active = false;
+  if(config_.asyncFootstepPlan)
+  {
+    startFootstepPlanThread();
+  }
 
   velModeData_.reset(false, objPoseWithoutOffset);
+
+  updateRefSnapshot();
+  updateMarkerState(true);
 }
 
 void ManipManager::stop()
 {
+  stopFootstepPlanThread();
+
+  if(spinner_)
+  {
+    spinner_->stop();
+    spinner_.reset();
+  }
   objPoseSub_.shutdown();
   objVelSub_.shutdown();
   nh_.reset();
@@ -154,16 +268,40 @@ void ManipManager::stop()
 
 void ManipManager::update()
 {
-  // Call ROS callback
-  callbackQueue_.callAvailable(ros::WallDuration());
+  waypointVisitNum_ = 0;
+
+  {
+    TimingHistogram::ScopedTimer timer(updateTimings_.realObj);
+    // Call ROS callback
+    if(!spinner_)
+    {
+      callbackQueue_.callAvailable(ros::WallDuration());
+    }
+    updateRealObj();
+  }
 
   if(velModeData_.enabled_)
   {
+    TimingHistogram::ScopedTimer timer(updateTimings_.velMode);
     updateForVelMode();
   }
-  updateObjTraj();
-  updateHandTraj();
-  updateFootstep();
+  {
+    TimingHistogram::ScopedTimer timer(updateTimings_.objTraj);
+    updateObjTraj();
+  }
+  {
+    TimingHistogram::ScopedTimer timer(updateTimings_.handTraj);
+    updateHandTraj();
+  }
+  {
+    TimingHistogram::ScopedTimer timer(updateTimings_.footstep);
+    updateFootstep();
+  }
+  {
+    TimingHistogram::ScopedTimer timer(updateTimings_.markerState);
+    updateMarkerState();
+  }
+  updateLogData();
 }
 
 void ManipManager::addToGUI(mc_rtc::gui::StateBuilder & gui)
@@ -172,18 +310,39 @@ void ManipManager::addToGUI(mc_rtc::gui::StateBuilder & gui)
                  mc_rtc::gui::Label("waypointQueueSize", [this]() { return std::to_string(waypointQueue_.size()); }));
   gui.addElement(
       {ctl().name(), config_.name, "Status"}, mc_rtc::gui::ElementsStacking::Horizontal,
-      mc_rtc::gui::Label("LeftManipPhase", [this]() { return std::to_string(manipPhases_.at(Hand::Left)->label()); }),
+      mc_rtc::gui::Label("LeftManipPhase",
+                         [this]() { return std::to_string(refSnapshot_.manipPhaseLabels.at(Hand::Left)); }),
       mc_rtc::gui::Label("RightManipPhase",
-                         [this]() { return std::to_string(manipPhases_.at(Hand::Right)->label()); }));
+                         [this]() { return std::to_string(refSnapshot_.manipPhaseLabels.at(Hand::Right)); }));
   gui.addElement({ctl().name(), config_.name, "Status"}, mc_rtc::gui::ElementsStacking::Horizontal,
                  mc_rtc::gui::Label("LeftHandSurface", [this]() { return surfaceName(Hand::Left); }),
                  mc_rtc::gui::Label("RightHandSurface", [this]() { return surfaceName(Hand::Right); }));
+  gui.addElement({ctl().name(), config_.name, "Status"},
+                 mc_rtc::gui::Label("FootstepPlanProgress", [this]() -> std::string {
+                   return planningFootstep() ? fmt::format("{:.0f}%", 100.0 * footstepPlanProgress()) : "Idle";
+                 }));
 
   gui.addElement(
       {ctl().name(), config_.name, "Config"},
       mc_rtc::gui::Label("objPoseInterpolator", [this]() { return config_.objPoseInterpolator; }),
       mc_rtc::gui::NumberInput(
-          "objHorizon", [this]() { return config_.objHorizon; }, [this](double v) { config_.objHorizon = v; }),
+          "objHorizon", [this]() { return config_.objHorizon; },
+          [this](double v) {
+            config_.objHorizon = v;
+            requireObjPoseFuncUpdate_ = true;
+          }),
+      mc_rtc::gui::Checkbox(
+          "incrementalObjTraj", [this]() { return config_.incrementalObjTraj; },
+          [this]() {
+            if(!config_.incrementalObjTraj && config_.objPoseInterpolator != "BangBang")
+            {
+              mc_rtc::log::error("[ManipManager] incrementalObjTraj is available only with the BangBang "
+                                 "objPoseInterpolator.");
+              return;
+            }
+            config_.incrementalObjTraj = !config_.incrementalObjTraj;
+            requireObjPoseFuncUpdate_ = true;
+          }),
       mc_rtc::gui::NumberInput(
           "handTaskStiffness", [this]() { return config_.handTaskStiffness; },
           [this](double v) { config_.handTaskStiffness = v; }),
@@ -201,16 +360,35 @@ void ManipManager::addToGUI(mc_rtc::gui::StateBuilder & gui)
       mc_rtc::gui::NumberInput(
           "doubleSupportRatio", [this]() { return config_.doubleSupportRatio; },
           [this](double v) { config_.doubleSupportRatio = v; }),
+      mc_rtc::gui::NumberInput(
+          "footstepQueueSize", [this]() { return config_.footstepQueueSize; },
+          [this](int v) { config_.footstepQueueSize = v; }),
+      mc_rtc::gui::Checkbox(
+          "asyncFootstepPlan", [this]() { return config_.asyncFootstepPlan; },
+          [this]() {
+            config_.asyncFootstepPlan = !config_.asyncFootstepPlan;
+            // The background thread is kept once it is started
+            if(config_.asyncFootstepPlan && !footstepPlanThread_.joinable())
+            {
+              startFootstepPlanThread();
+            }
+          }),
       mc_rtc::gui::NumberInput(
           "handForceArrowScale", [this]() { return config_.handForceArrowScale; },
-          [this](double v) { config_.handForceArrowScale = v; }));
+          [this](double v) { config_.handForceArrowScale = v; }),
+      mc_rtc::gui::NumberInput(
+          "markerUpdateDecimation", [this]() { return config_.markerUpdateDecimation; },
+          [this](int v) { config_.markerUpdateDecimation = std::max(v, 1); }));
 
   gui.addElement({ctl().name(), config_.name, "Config", "VelMode"},
                  mc_rtc::gui::Checkbox(
                      "nonholonomicObjectMotion", [this]() { return velModeData_.config_.nonholonomicObjectMotion; },
                      [this]() {
                        velModeData_.config_.nonholonomicObjectMotion = !velModeData_.config_.nonholonomicObjectMotion;
-                     }));
+                     }),
+                 mc_rtc::gui::NumberInput(
+                     "feasibleStepSearchNum", [this]() { return velModeData_.config_.feasibleStepSearchNum; },
+                     [this](int v) { velModeData_.config_.feasibleStepSearchNum = std::max(v, 0); }));
 
   gui.addElement({ctl().name(), config_.name, "ImpedanceGain"},
                  mc_rtc::gui::ArrayInput(
@@ -250,7 +428,7 @@ void ManipManager::addToGUI(mc_rtc::gui::StateBuilder & gui)
             sva::ForceVecd wrench = sva::ForceVecd::Zero();
             for(const auto & hand : Hands::Both)
             {
-              wrench += calcRefHandWrench(hand, ctl().t());
+              wrench += refSnapshot_.handWrenches.at(hand);
             }
             wrench /= 2.0;
             return wrench.vector();
@@ -264,14 +442,42 @@ void ManipManager::addToGUI(mc_rtc::gui::StateBuilder & gui)
           }),
       mc_rtc::gui::ArrayInput(
           "Left hand wrench (in hand frame)", {"cx", "cy", "cz", "fx", "fy", "fz"},
-          [this]() { return calcRefHandWrench(Hand::Left, ctl().t()).vector(); },
+          [this]() { return refSnapshot_.handWrenches.at(Hand::Left).vector(); },
           [this](const Eigen::Vector6d & v) { setRefHandWrench(Hand::Left, sva::ForceVecd(v), ctl().t() + 1.0, 3.0); }),
       mc_rtc::gui::ArrayInput(
           "Right hand wrench (in hand frame)", {"cx", "cy", "cz", "fx", "fy", "fz"},
-          [this]() { return calcRefHandWrench(Hand::Right, ctl().t()).vector(); },
+          [this]() { return refSnapshot_.handWrenches.at(Hand::Right).vector(); },
           [this](const Eigen::Vector6d & v) {
             setRefHandWrench(Hand::Right, sva::ForceVecd(v), ctl().t() + 1.0, 3.0);
           }));
+
+  gui.addElement({ctl().name(), config_.name, "WaypointsMarker"},
+                 mc_rtc::gui::Trajectory("Waypoints", {mc_rtc::gui::Color::Green, 0.04},
+                                         [this]() -> const std::vector<sva::PTransformd> & {
+                                           return markerState().waypointPoses;
+                                         }));
+
+  mc_rtc::gui::ArrowConfig arrowConfig;
+  arrowConfig.color = mc_rtc::gui::Color::Magenta;
+  arrowConfig.head_diam = 0.045;
+  arrowConfig.head_len = 0.05;
+  arrowConfig.shaft_diam = 0.03;
+  for(const auto & hand : Hands::Both)
+  {
+    gui.addElement(
+        {ctl().name(), config_.name, "HandWrench"},
+        mc_rtc::gui::Arrow(
+            std::to_string(hand) + "HandForceArrow", arrowConfig,
+            [this, hand]() -> const Eigen::Vector3d & { return markerState().handForceArrowStarts.at(hand); },
+            [this, hand]() -> const Eigen::Vector3d & { return markerState().handForceArrowEnds.at(hand); }));
+  }
+
+  updateTimings_.realObj.addToGUI(gui, {ctl().name(), config_.name, "Timing"}, "realObj");
+  updateTimings_.velMode.addToGUI(gui, {ctl().name(), config_.name, "Timing"}, "velMode");
+  updateTimings_.objTraj.addToGUI(gui, {ctl().name(), config_.name, "Timing"}, "objTraj");
+  updateTimings_.handTraj.addToGUI(gui, {ctl().name(), config_.name, "Timing"}, "handTraj");
+  updateTimings_.footstep.addToGUI(gui, {ctl().name(), config_.name, "Timing"}, "footstep");
+  updateTimings_.markerState.addToGUI(gui, {ctl().name(), config_.name, "Timing"}, "markerState");
 }
 
 void ManipManager::removeFromGUI(mc_rtc::gui::StateBuilder & gui)
@@ -282,29 +488,53 @@ void ManipManager::removeFromGUI(mc_rtc::gui::StateBuilder & gui)
 void ManipManager::addToLogger(mc_rtc::Logger & logger)
 {
   logger.addLogEntry(config_.name + "_waypointQueueSize", this, [this]() { return waypointQueue_.size(); });
+  logger.addLogEntry(config_.name + "_waypointVisitNum", this, [this]() { return waypointVisitNum_; });
 
-  logger.addLogEntry(config_.name + "_objPose_ref", this, [this]() { return ctl().obj().posW(); });
-  logger.addLogEntry(config_.name + "_objPose_measured", this, [this]() { return ctl().realObj().posW(); });
+  // Object state is written to a separate log file at a lower rate if objStateLogDecimation is greater than 1
+  mc_rtc::Logger & objStateLogger = objStateLogDecimator_.logger(logger);
+  objStateLogger.addLogEntry(config_.name + "_objPose_ref", this,
+                             [this]() -> const sva::PTransformd & { return refSnapshot_.objPose; });
+  objStateLogger.addLogEntry(config_.name + "_objPose_measured", this,
+                             [this]() -> sva::PTransformd { return ctl().realObj().posW(); });
 
-  logger.addLogEntry(config_.name + "_objVel_ref", this, [this]() { return ctl().obj().velW(); });
-  logger.addLogEntry(config_.name + "_objVel_measured", this, [this]() { return ctl().realObj().velW(); });
+  objStateLogger.addLogEntry(config_.name + "_objVel_ref", this,
+                             [this]() -> const sva::MotionVecd & { return refSnapshot_.objVel; });
+  objStateLogger.addLogEntry(config_.name + "_objVel_measured", this,
+                             [this]() -> sva::MotionVecd { return ctl().realObj().velW(); });
+  MC_RTC_LOG_HELPER(config_.name + "_objPoseLatency", objPoseLatency_);
 
   MC_RTC_LOG_HELPER(config_.name + "_objPoseOffset", objPoseOffset_);
 
+  // Manipulation phases are logged as integers, and the table of their labels is logged as a constant entry that is
+  // kept during the whole run so that the columns of the log do not change
   for(const auto & hand : Hands::Both)
   {
     logger.addLogEntry(config_.name + "_manipPhase_" + std::to_string(hand), this,
-                       [this, hand]() { return std::to_string(manipPhases_.at(hand)->label()); });
+                       [this, hand]() { return static_cast<int>(refSnapshot_.manipPhaseLabels.at(hand)); });
+  }
+  std::string labelTable;
+  for(int i = 0; i <= static_cast<int>(ManipPhaseLabel::Release); i++)
+  {
+    labelTable += (i == 0 ? "" : ", ") + std::to_string(i) + ": " + std::to_string(static_cast<ManipPhaseLabel>(i));
   }
+  logger.addLogEntry(config_.name + "_manipPhase_labels", this,
+                     [labelTable]() -> const std::string & { return labelTable; });
 
-  logger.addLogEntry(config_.name + "_velMode", this,
-                     [this]() -> std::string { return velModeData_.enabled_ ? "ON" : "OFF"; });
+  logger.addLogEntry(config_.name + "_velMode", this, [this]() { return velModeData_.enabled_; });
   logger.addLogEntry(config_.name + "_targetVel", this, [this]() { return velModeData_.targetVel_; });
+
+  updateTimings_.realObj.addToLogger(logger, config_.name + "_Timing_realObj", this);
+  updateTimings_.velMode.addToLogger(logger, config_.name + "_Timing_velMode", this);
+  updateTimings_.objTraj.addToLogger(logger, config_.name + "_Timing_objTraj", this);
+  updateTimings_.handTraj.addToLogger(logger, config_.name + "_Timing_handTraj", this);
+  updateTimings_.footstep.addToLogger(logger, config_.name + "_Timing_footstep", this);
+  updateTimings_.markerState.addToLogger(logger, config_.name + "_Timing_markerState", this);
 }
 
 void ManipManager::removeFromLogger(mc_rtc::Logger & logger)
 {
   logger.removeLogEntries(this);
+  objStateLogDecimator_.logger(logger).removeLogEntries(this);
 }
 
 const std::string & ManipManager::surfaceName(const Hand & hand) const
@@ -334,12 +564,15 @@ bool ManipManager::appendWaypoint(const Waypoint & newWaypoint)
 
   // Push to the queue
   waypointQueue_.push_back(newWaypoint);
+  requireObjPoseFuncUpdate_ = true;
 
   return true;
 }
 
 void ManipManager::clearWaypointQueue()
 {
+  cancelFootstepPlan();
+  footstepGenState_.active = false;
   ctl().footManager_->clearFootstepQueue();
   const auto & footstepQueue = ctl().footManager_->footstepQueue();
   double stopTime;
@@ -353,22 +586,24 @@ void ManipManager::clearWaypointQueue()
     stopTime = footstepQueue.back().transitEndTime;
   }
   waypointQueue_.clear();
+  waypointQueueGen_++;
   // \todo Avoid discontinuous changes in object velocity
   waypointQueue_.push_back(Waypoint(ctl().t(), stopTime, calcRefObjPose(stopTime)));
   lastWaypointPose_ = calcRefObjPose(ctl().t());
+  requireObjPoseFuncUpdate_ = true;
 }
 
 void ManipManager::reachHandToObj()
 {
   for(const auto & hand : Hands::Both)
   {
-    if(manipPhases_.at(hand)->label() != ManipPhaseLabel::Free)
+    if(manipPhases_.at(hand).label() != ManipPhaseLabel::Free)
     {
       mc_rtc::log::error("[ManipManager] The hand must be in Free phase to reach, but the {} hand is in {} phase.",
-                         std::to_string(hand), std::to_string(ctl().manipManager_->manipPhase(hand)->label()));
+                         std::to_string(hand), std::to_string(manipPhases_.at(hand).label()));
       continue;
     }
-    sva::PTransformd reachHandPose = config_.objToHandTranss.at(hand) * ctl().obj().posW();
+    sva::PTransformd reachHandPose = config_.objToHandTranss.at(hand) * refSnapshot_.objPose;
     double reachHandDist =
         (reachHandPose.translation() - ctl().handTasks_.at(hand)->surfacePose().translation()).norm();
     if(reachHandDist > config_.reachHandDistThre)
@@ -378,7 +613,7 @@ void ManipManager::reachHandToObj()
           std::to_string(hand), reachHandDist, config_.reachHandDistThre);
       continue;
     }
-    manipPhases_.at(hand) = std::make_shared<ManipPhase::PreReach>(hand, this);
+    manipPhases_.at(hand).start(ManipPhaseLabel::PreReach);
   }
 }
 
@@ -386,20 +621,20 @@ void ManipManager::releaseHandFromObj()
 {
   for(const auto & hand : Hands::Both)
   {
-    if(manipPhases_.at(hand)->label() != ManipPhaseLabel::Hold)
+    if(manipPhases_.at(hand).label() != ManipPhaseLabel::Hold)
     {
       mc_rtc::log::error("[ManipManager] The hand must be in Hold phase to release, but the {} hand is in {} phase.",
-                         std::to_string(hand), std::to_string(ctl().manipManager_->manipPhase(hand)->label()));
+                         std::to_string(hand), std::to_string(manipPhases_.at(hand).label()));
       continue;
     }
 
     if(config_.ungraspCommands.empty())
     {
-      manipPhases_.at(hand) = std::make_shared<ManipPhase::Release>(hand, this);
+      manipPhases_.at(hand).start(ManipPhaseLabel::Release);
     }
     else
     {
-      manipPhases_.at(hand) = std::make_shared<ManipPhase::Ungrasp>(hand, this);
+      manipPhases_.at(hand).start(ManipPhaseLabel::Ungrasp);
     }
   }
 }
@@ -449,9 +684,9 @@ void ManipManager::setRefHandWrench(const Hand & hand,
 
 bool ManipManager::interpolatingRefHandWrench() const
 {
-  for(const auto & handWrenchFuncKV : handWrenchFuncs_)
+  for(const auto & handWrenchFunc : handWrenchFuncs_)
   {
-    if(ctl().t() < std::next(handWrenchFuncKV.second->points().rbegin())->first)
+    if(ctl().t() < std::next(handWrenchFunc->points().rbegin())->first)
     {
       return true;
     }
@@ -477,12 +712,12 @@ bool ManipManager::startVelMode()
     return false;
   }
 
-  if(!(manipPhases_.at(Hand::Left)->label() == ManipPhaseLabel::Hold
-       || manipPhases_.at(Hand::Right)->label() == ManipPhaseLabel::Hold))
+  if(!(manipPhases_.at(Hand::Left).label() == ManipPhaseLabel::Hold
+       || manipPhases_.at(Hand::Right).label() == ManipPhaseLabel::Hold))
   {
     mc_rtc::log::error(
         "[ManipManager] startVelMode is available only when the manipulation phase is Hold. Left: {}, Right: {}",
-        std::to_string(manipPhases_.at(Hand::Left)->label()), std::to_string(manipPhases_.at(Hand::Right)->label()));
+        std::to_string(manipPhases_.at(Hand::Left).label()), std::to_string(manipPhases_.at(Hand::Right).label()));
     return false;
   }
 
@@ -493,12 +728,6 @@ bool ManipManager::startVelMode()
     return false;
   }
 
-  if(ctl().footManager_->velModeData().config_.enableOnlineFootstepUpdate)
-  {
-    mc_rtc::log::error("[ManipManager] enableOnlineFootstepUpdate must be false in the FootManager velocity mode.");
-    return false;
-  }
-
   if(!ctl().footManager_->startVelMode())
   {
     mc_rtc::log::error("[ManipManager] Failed to start velocity mode in Footmanager.");
@@ -520,6 +749,7 @@ bool ManipManager::endVelMode()
     return false;
   }
 
+  removeVelModePreview();
   velModeData_.reset(false, calcRefObjPose(ctl().t()));
 
   ctl().footManager_->endVelMode();
@@ -530,119 +760,246 @@ bool ManipManager::endVelMode()
 void ManipManager::setRelativeVel(const Eigen::Vector3d & targetVel)
 {
   velModeData_.targetVel_ = targetVel;
+  if(velModeData_.velProfile_.pointNum > 0)
+  {
+    velModeData_.velProfile_.pointNum = 0;
+    velModeData_.requirePreview_ = true;
+  }
   if(velModeData_.config_.nonholonomicObjectMotion)
   {
     velModeData_.targetVel_.y() = 0;
   }
 }
 
+bool ManipManager::setRelativeVelProfile(const VelProfile & velProfile)
+{
+  if(!velProfile.validate())
+  {
+    return false;
+  }
+
+  VelProfile & newVelProfile = velModeData_.velProfile_;
+  newVelProfile = velProfile;
+  if(velModeData_.config_.nonholonomicObjectMotion)
+  {
+    for(size_t i = 0; i < newVelProfile.pointNum; i++)
+    {
+      newVelProfile.vels[i][1] = 0;
+    }
+  }
+
+  // Set the current velocity for the GUI and the logger
+  velModeData_.targetVel_ = newVelProfile.velAt(ctl().t());
+  velModeData_.requirePreview_ = true;
+
+  return true;
+}
+
 void ManipManager::updateObjTraj()
 {
+  LMC_TRACE_SCOPE("ManipManager::updateObjTraj");
+
   // Update waypointQueue_
   while(!waypointQueue_.empty() && waypointQueue_.front().endTime < ctl().t())
   {
     lastWaypointPose_ = waypointQueue_.front().pose;
     waypointQueue_.pop_front();
+    waypointPopCount_++;
+    requireObjPoseFuncUpdate_ = true;
   }
 
   // Update objPoseFunc_
+  // In the incremental mode, objPoseFunc_ is kept unless the waypoint queue is modified or the horizon end passes the
+  // last knot (i.e., the end of the waypoint cut off by the horizon, or the holding knot)
+  // The waypoints after the horizon are not added so that the cost does not depend on the waypoint queue length
+  if(!config_.incrementalObjTraj || requireObjPoseFuncUpdate_
+     || objPoseFunc_->endTime() < ctl().t() + config_.objHorizon)
   {
-    auto objPoseFuncBangBang =
-        std::dynamic_pointer_cast<TrajColl::BangBangInterpolator<sva::PTransformd, sva::MotionVecd>>(objPoseFunc_);
+    requireObjPoseFuncUpdate_ = false;
+    objPoseFuncTime_ = ctl().t();
+    setObjPoseFuncPoints(*objPoseFunc_, ctl().t() + config_.objHorizon);
+  }
 
-    sva::PTransformd currentObjPose = lastWaypointPose_;
+  // Update objPoseOffset_
+  {
+    if(objPoseOffsetFunc_)
+    {
+      objPoseOffset_ = (*objPoseOffsetFunc_)(std::min(ctl().t(), objPoseOffsetFunc_->endTime()));
+      if(objPoseOffsetFunc_->endTime() <= ctl().t())
+      {
+        objPoseOffsetFunc_.reset();
+      }
+    }
+  }
 
-    objPoseFunc_->clearPoints();
+  // Update reference snapshot
+  updateRefSnapshot();
+
+  // Update control object pose
+  {
+    ctl().obj().posW(refSnapshot_.objPose);
+    ctl().obj().velW(refSnapshot_.objVel);
+  }
+}
 
-    if(waypointQueue_.empty() || ctl().t() < waypointQueue_.front().startTime)
+template<class WaypointContainer>
+size_t ManipManager::setObjPoseFuncPoints(TrajColl::Interpolator<sva::PTransformd, sva::MotionVecd> & objPoseFunc,
+                                          const WaypointContainer & waypointQueue,
+                                          const sva::PTransformd & lastWaypointPose,
+                                          double t,
+                                          double endTime,
+                                          double objHorizon,
+                                          double objHoldDuration)
+{
+  auto objPoseFuncBangBang =
+      dynamic_cast<TrajColl::BangBangInterpolator<sva::PTransformd, sva::MotionVecd> *>(&objPoseFunc);
+
+  sva::PTransformd currentObjPose = lastWaypointPose;
+
+  objPoseFunc.clearPoints();
+
+  if(waypointQueue.empty() || t < waypointQueue.front().startTime)
+  {
+    objPoseFunc.appendPoint(std::make_pair(t, currentObjPose));
+  }
+
+  size_t visitNum = 0;
+  for(const auto & waypoint : waypointQueue)
+  {
+    visitNum++;
+    if(objPoseFunc.points().empty() || waypoint.startTime < objPoseFunc.points().rbegin()->first)
     {
-      objPoseFunc_->appendPoint(std::make_pair(ctl().t(), currentObjPose));
+      objPoseFunc.appendPoint(std::make_pair(waypoint.startTime, currentObjPose));
     }
 
-    for(const auto & waypoint : waypointQueue_)
+    currentObjPose = waypoint.pose;
+    if(objPoseFuncBangBang)
     {
-      if(objPoseFunc_->points().empty() || waypoint.startTime < objPoseFunc_->points().rbegin()->first)
-      {
-        objPoseFunc_->appendPoint(std::make_pair(waypoint.startTime, currentObjPose));
-      }
-
-      currentObjPose = waypoint.pose;
-      if(objPoseFuncBangBang)
-      {
-        double accelDuration = waypoint.config("accelDuration", 0.0);
-        objPoseFuncBangBang->appendPoint(std::make_pair(waypoint.endTime, currentObjPose), accelDuration);
-      }
-      else
-      {
-        objPoseFunc_->appendPoint(std::make_pair(waypoint.endTime, currentObjPose));
-      }
-
-      if(ctl().t() + config_.objHorizon <= waypoint.endTime && !requireFootstepFollowingObj_)
-      {
-        break;
-      }
+      objPoseFuncBangBang->appendPoint(std::make_pair(waypoint.endTime, currentObjPose),
+                                       waypoint.options.accelDuration);
+    }
+    else
+    {
+      objPoseFunc.appendPoint(std::make_pair(waypoint.endTime, currentObjPose));
     }
 
-    if(waypointQueue_.empty() || waypointQueue_.back().endTime < ctl().t() + config_.objHorizon)
+    if(endTime <= waypoint.endTime)
     {
-      objPoseFunc_->appendPoint(std::make_pair(ctl().t() + config_.objHorizon, currentObjPose));
+      break;
     }
+  }
 
-    objPoseFunc_->calcCoeff();
+  if(waypointQueue.empty() || waypointQueue.back().endTime < t + objHorizon)
+  {
+    objPoseFunc.appendPoint(std::make_pair(t + objHoldDuration, currentObjPose));
   }
 
-  // Update objPoseOffset_
+  objPoseFunc.calcCoeff();
+
+  return visitNum;
+}
+
+void ManipManager::setObjPoseFuncPoints(TrajColl::Interpolator<sva::PTransformd, sva::MotionVecd> & objPoseFunc,
+                                        double endTime)
+{
+  double objHoldDuration = (config_.incrementalObjTraj ? 2.0 : 1.0) * config_.objHorizon;
+  waypointVisitNum_ += setObjPoseFuncPoints(objPoseFunc, waypointQueue_, lastWaypointPose_, ctl().t(), endTime,
+                                            config_.objHorizon, objHoldDuration);
+}
+
+void ManipManager::updateRefSnapshot()
+{
+  refSnapshot_.t = ctl().t();
+  refSnapshot_.objPoseWithoutOffset = calcRefObjPose(ctl().t());
+  refSnapshot_.objPoseOffset = objPoseOffset_;
+  refSnapshot_.objPose = objPoseOffset_ * refSnapshot_.objPoseWithoutOffset;
+  refSnapshot_.objVel = calcRefObjVel(ctl().t());
+  for(const auto & hand : Hands::Both)
   {
-    if(objPoseOffsetFunc_)
+    refSnapshot_.handWrenches.at(hand) = calcRefHandWrench(hand, ctl().t());
+    refSnapshot_.manipPhaseLabels.at(hand) = manipPhases_.at(hand).label();
+    refSnapshot_.handTargetPoses.at(hand) = ctl().handTasks_.at(hand)->targetPose();
+  }
+}
+
+void ManipManager::copyRefFuncs(RefFuncSnapshot & snapshot) const
+{
+  // Copy the waypoints until the one that ends the object pose function in the same way as setObjPoseFuncPoints
+  // The additional configuration is not copied because it is not used in the object trajectory
+  double objPoseFuncEndTime = objPoseFuncTime_ + config_.objHorizon;
+  snapshot.waypoints.clear();
+  for(const auto & waypoint : waypointQueue_)
+  {
+    snapshot.waypoints.emplace_back(waypoint.startTime, waypoint.endTime, waypoint.pose);
+    snapshot.waypoints.back().options = waypoint.options;
+    if(objPoseFuncEndTime <= waypoint.endTime)
     {
-      objPoseOffset_ = (*objPoseOffsetFunc_)(std::min(ctl().t(), objPoseOffsetFunc_->endTime()));
-      if(objPoseOffsetFunc_->endTime() <= ctl().t())
-      {
-        objPoseOffsetFunc_.reset();
-      }
+      break;
     }
   }
+  snapshot.lastWaypointPose = lastWaypointPose_;
+  snapshot.objPoseFuncTime = objPoseFuncTime_;
+  snapshot.objHorizon = config_.objHorizon;
+  snapshot.objHoldDuration = (config_.incrementalObjTraj ? 2.0 : 1.0) * config_.objHorizon;
+  snapshot.bangBangObjPose = (config_.objPoseInterpolator == "BangBang");
 
-  // Update control object pose
-  sva::PTransformd objPoseWithoutOffset = calcRefObjPose(ctl().t());
+  snapshot.objPoseOffset = refSnapshot_.objPoseOffset;
+  for(const auto & hand : Hands::Both)
   {
-    ctl().obj().posW(objPoseOffset_ * objPoseWithoutOffset);
-    ctl().obj().velW(calcRefObjVel(ctl().t()));
+    snapshot.objToHandTranss.at(hand) = config_.objToHandTranss.at(hand);
+    snapshot.manipPhaseLabels.at(hand) = refSnapshot_.manipPhaseLabels.at(hand);
+
+    auto & handWrenchPoints = snapshot.handWrenchPoints.at(hand);
+    handWrenchPoints.clear();
+    for(const auto & point : handWrenchFuncs_.at(hand)->points())
+    {
+      handWrenchPoints.push_back(point);
+    }
   }
+}
 
-  // Update object waypoints visualization
+void ManipManager::RefFuncSnapshot::build()
+{
+  if(!objPoseFunc)
   {
-    std::vector<sva::PTransformd> waypointPoseList = {objPoseWithoutOffset};
-    for(const auto & waypoint : waypointQueue_)
+    if(bangBangObjPose)
     {
-      waypointPoseList.push_back(waypoint.pose);
+      objPoseFunc = std::make_shared<TrajColl::BangBangInterpolator<sva::PTransformd, sva::MotionVecd>>();
     }
+    else
+    {
+      objPoseFunc = std::make_shared<TrajColl::CubicInterpolator<sva::PTransformd, sva::MotionVecd>>();
+    }
+  }
+  setObjPoseFuncPoints(*objPoseFunc, waypoints, lastWaypointPose, objPoseFuncTime, objPoseFuncTime + objHorizon,
+                       objHorizon, objHoldDuration);
 
-    ctl().gui()->removeCategory({ctl().name(), config_.name, "WaypointsMarker"});
-    ctl().gui()->addElement({ctl().name(), config_.name, "WaypointsMarker"},
-                            mc_rtc::gui::Trajectory("Waypoints", {mc_rtc::gui::Color::Green, 0.04},
-                                                    [waypointPoseList]() { return waypointPoseList; }));
+  for(const auto & hand : Hands::Both)
+  {
+    auto & handWrenchFunc = handWrenchFuncs.at(hand);
+    if(!handWrenchFunc)
+    {
+      handWrenchFunc = std::make_shared<TrajColl::CubicInterpolator<sva::ForceVecd>>();
+    }
+    handWrenchFunc->clearPoints();
+    for(const auto & point : handWrenchPoints.at(hand))
+    {
+      handWrenchFunc->appendPoint(point);
+    }
+    handWrenchFunc->calcCoeff();
   }
 }
 
 void ManipManager::updateHandTraj()
 {
+  LMC_TRACE_SCOPE("ManipManager::updateHandTraj");
+
   // Update manipulation phase
   for(const auto & hand : Hands::Both)
   {
-    manipPhases_.at(hand)->run();
-    if(manipPhases_.at(hand)->complete())
-    {
-      auto nextManipPhase = manipPhases_.at(hand)->makeNextManipPhase();
-      if(nextManipPhase)
-      {
-        manipPhases_.at(hand) = nextManipPhase;
-      }
-      else
-      {
-        mc_rtc::log::error_and_throw("[ManipManager] {} next manipulation phase is nullptr.", std::to_string(hand));
-      }
-    }
+    manipPhases_.at(hand).run();
+    refSnapshot_.manipPhaseLabels.at(hand) = manipPhases_.at(hand).label();
+    refSnapshot_.handTargetPoses.at(hand) = ctl().handTasks_.at(hand)->targetPose();
   }
 
   // Set impedance gains of hand tasks
@@ -658,59 +1015,162 @@ void ManipManager::updateHandTraj()
   // Set target wrench of hand tasks
   for(const auto & hand : Hands::Both)
   {
-    ctl().handTasks_.at(hand)->targetWrench(calcRefHandWrench(hand, ctl().t()));
+    ctl().handTasks_.at(hand)->targetWrench(refSnapshot_.handWrenches.at(hand));
   }
+}
 
-  // Visualize hand forces
-  for(const auto & hand : Hands::Both)
+void ManipManager::updateMarkerState(bool force)
+{
+  if(!force && ++markerUpdateCount_ < config_.markerUpdateDecimation)
   {
-    ctl().gui()->removeElement({ctl().name(), config_.name, "HandWrench"}, std::to_string(hand) + "HandForceArrow");
+    return;
   }
-  if(config_.handForceArrowScale > 0.0)
+  markerUpdateCount_ = 0;
+
+  // Update the marker state not read by GUI, then swap
+  MarkerState & markerState = markerStates_[1 - markerStateIdx_];
+
+  markerState.waypointPoses.clear();
+  markerState.waypointPoses.push_back(refSnapshot_.objPoseWithoutOffset);
+  for(const auto & waypoint : waypointQueue_)
   {
-    mc_rtc::gui::ArrowConfig arrowConfig;
-    arrowConfig.color = mc_rtc::gui::Color::Magenta;
-    arrowConfig.head_diam = 0.045;
-    arrowConfig.head_len = 0.05;
-    arrowConfig.shaft_diam = 0.03;
-    for(const auto & hand : Hands::Both)
+    if(markerState.waypointPoses.size() > static_cast<size_t>(config_.maxWaypointMarkerNum))
     {
-      Eigen::Vector3d force = calcRefHandWrench(hand, ctl().t()).force();
-      if(force.norm() > 0.0)
-      {
-        sva::PTransformd pose = ctl().handTasks_.at(hand)->targetPose();
-        ctl().gui()->addElement({ctl().name(), config_.name, "HandWrench"},
-                                mc_rtc::gui::Arrow(
-                                    std::to_string(hand) + "HandForceArrow", arrowConfig,
-                                    [this, pose]() -> Eigen::Vector3d { return pose.translation(); },
-                                    [this, pose, force]() -> Eigen::Vector3d {
-                                      return pose.translation()
-                                             + config_.handForceArrowScale * (pose.rotation().transpose() * force);
-                                    }));
-      }
+      break;
+    }
+    markerState.waypointPoses.push_back(waypoint.pose);
+  }
+
+  for(const auto & hand : Hands::Both)
+  {
+    // The arrow elements are kept in GUI, and the arrows are hidden by moving them far below the ground when the force
+    // is zero or the scale is not positive, because GUI draws the arrow head even if the arrow length is zero
+    const Eigen::Vector3d & force = refSnapshot_.handWrenches.at(hand).force();
+    markerState.handForceArrowVisibles.at(hand) = (config_.handForceArrowScale > 0.0 && force.norm() > 0.0);
+    if(markerState.handForceArrowVisibles.at(hand))
+    {
+      const sva::PTransformd & pose = refSnapshot_.handTargetPoses.at(hand);
+      markerState.handForceArrowStarts.at(hand) = pose.translation();
+      markerState.handForceArrowEnds.at(hand) =
+          pose.translation() + config_.handForceArrowScale * (pose.rotation().transpose() * force);
+    }
+    else
+    {
+      markerState.handForceArrowStarts.at(hand) = MarkerState::hiddenPos;
+      markerState.handForceArrowEnds.at(hand) = MarkerState::hiddenPos;
     }
   }
+
+  markerStateIdx_ = 1 - markerStateIdx_;
+}
+
+void ManipManager::updateLogData()
+{
+  objStateLogDecimator_.update(ctl().t());
 }
 
 void ManipManager::updateFootstep()
 {
-  if(!requireFootstepFollowingObj_)
+  LMC_TRACE_SCOPE("ManipManager::updateFootstep");
+
+  // Hand off the plan at the beginning of the control cycle
+  if(footstepPlanPendingId_ > 0 && footstepPlanDone_.load(std::memory_order_acquire))
   {
-    return;
+    handOffFootstepPlan();
   }
-  requireFootstepFollowingObj_ = false;
+
+  if(requireFootstepFollowingObj_)
+  {
+    requireFootstepFollowingObj_ = false;
+    if(config_.asyncFootstepPlan && footstepPlanThread_.joinable())
+    {
+      startFootstepPlan();
+    }
+    else
+    {
+      startFootstepGen();
+    }
+  }
+
+  // Continue copying the waypoint queue to the request of footstep planning
+  if(footstepPlanPendingId_ > 0 && !footstepPlanRequestSent_)
+  {
+    sendFootstepPlanRequest();
+  }
+
+  // Generate footsteps until the footstep queue is filled
+  // At least two footsteps are kept so that the next footstep is appended before the current one ends
+  const auto & footstepQueue = ctl().footManager_->footstepQueue();
+  size_t footstepQueueSize = static_cast<size_t>(std::max(config_.footstepQueueSize, 2));
+  while(footstepGenState_.active && (config_.footstepQueueSize <= 0 || footstepQueue.size() < footstepQueueSize))
+  {
+    updateFootstepObjPoseFunc(false);
+    ctl().footManager_->appendFootstep(calcNextFootstep(footstepGenState_, *footstepObjPoseFunc_));
+  }
+}
+
+Eigen::Vector3d ManipManager::integrateRelativeVel(double startTime, double endTime) const
+{
+  const VelProfile & velProfile = velModeData_.velProfile_;
+  if(velProfile.pointNum == 0)
+  {
+    return (endTime - startTime) * velModeData_.targetVel_;
+  }
+
+  // Integrate the piecewise constant velocity, which is zero after the last point
+  Eigen::Vector3d deltaTrans = Eigen::Vector3d::Zero();
+  for(size_t i = 0; i + 1 < velProfile.pointNum; i++)
+  {
+    double segStartTime = (i == 0 ? startTime : std::max(velProfile.times[i], startTime));
+    double segEndTime = std::min(velProfile.times[i + 1], endTime);
+    if(segStartTime < segEndTime)
+    {
+      deltaTrans += (segEndTime - segStartTime) * velProfile.vel(i);
+    }
+  }
+  return deltaTrans;
+}
+
+bool ManipManager::initFootstepGenState(FootstepGenState & state) const
+{
+  state.active = false;
 
   if(waypointQueue_.empty())
   {
     mc_rtc::log::error("[ManipManager] Waypoint queue must not be empty in updateFootstep.");
-    return;
+    return false;
   }
   if(!ctl().footManager_->footstepQueue().empty())
   {
     mc_rtc::log::error("[ManipManager] Footstep queue must be empty in updateFootstep.");
-    return;
+    return false;
   }
 
+  state.active = true;
+  state.foot = Foot::Left;
+  state.footMidpose = projGround(sva::interpolate(ctl().footManager_->targetFootPose(Foot::Left),
+                                                  ctl().footManager_->targetFootPose(Foot::Right), 0.5));
+  state.startTime = ctl().t() + 1.0;
+  state.endTime = waypointQueue_.back().endTime;
+
+  // Copy the configuration so that the generation does not access the managers
+  FootstepGenConfig & genConfig = state.config;
+  const auto & footManagerConfig = ctl().footManager_->config();
+  genConfig.footstepDuration = config_.footstepDuration;
+  genConfig.doubleSupportRatio = config_.doubleSupportRatio;
+  genConfig.objToFootMidTrans = config_.objToFootMidTrans;
+  for(const auto & foot : Feet::Both)
+  {
+    genConfig.midToFootTranss[foot] = footManagerConfig.midToFootTranss.at(foot);
+  }
+  genConfig.deltaTransLimit = footManagerConfig.deltaTransLimit;
+
+  return true;
+}
+
+Footstep ManipManager::calcNextFootstep(FootstepGenState & state,
+                                        const TrajColl::Interpolator<sva::PTransformd, sva::MotionVecd> & objPoseFunc)
+{
   auto convertTo2d = [](const sva::PTransformd & pose) -> Eigen::Vector3d {
     return Eigen::Vector3d(pose.translation().x(), pose.translation().y(), mc_rbdyn::rpyFromMat(pose.rotation()).z());
   };
@@ -718,32 +1178,289 @@ void ManipManager::updateFootstep()
     return sva::PTransformd(sva::RotZ(trans.z()), Eigen::Vector3d(trans.x(), trans.y(), 0));
   };
 
-  Foot foot = Foot::Left;
-  sva::PTransformd footMidpose = projGround(sva::interpolate(ctl().footManager_->targetFootPose(Foot::Left),
-                                                             ctl().footManager_->targetFootPose(Foot::Right), 0.5));
-  double startTime = ctl().t() + 1.0;
-  while(startTime < waypointQueue_.back().endTime)
+  const FootstepGenConfig & genConfig = state.config;
+
+  // The last footstep aligns the feet at the final foot midpose
+  if(state.endTime <= state.startTime)
+  {
+    state.active = false;
+    return genConfig.makeFootstep(state.foot, state.footMidpose, state.startTime);
+  }
+
+  double objPoseTime = state.startTime + genConfig.footstepDuration;
+  if(objPoseFunc.endTime() < objPoseTime)
+  {
+    objPoseTime = objPoseFunc.endTime();
+  }
+  Eigen::Vector3d deltaTrans =
+      convertTo2d(genConfig.objToFootMidTrans * objPoseFunc(objPoseTime) * state.footMidpose.inv());
+  state.footMidpose = convertTo3d(genConfig.clampDeltaTrans(deltaTrans, state.foot)) * state.footMidpose;
+  Footstep footstep = genConfig.makeFootstep(state.foot, state.footMidpose, state.startTime);
+
+  state.foot = opposite(state.foot);
+  state.startTime = footstep.transitEndTime;
+
+  return footstep;
+}
+
+void ManipManager::startFootstepGen()
+{
+  if(initFootstepGenState(footstepGenState_))
+  {
+    // The object pose function for the control horizon does not cover the footsteps
+    updateFootstepObjPoseFunc(true);
+  }
+}
+
+void ManipManager::updateFootstepObjPoseFunc(bool force)
+{
+  // The object pose function is built only up to the horizon after the next footstep, and is rebuilt when the
+  // generation passes its end, so that the cost in each control cycle does not depend on the waypoint queue length
+  // With the BangBang interpolator, the object poses before the cut are same as those of the function covering the
+  // whole queue
+  double objPoseTime = footstepGenState_.startTime + footstepGenState_.config.footstepDuration;
+  if(!force
+     && (objPoseTime <= footstepObjPoseFuncEndTime_
+         || (!waypointQueue_.empty() && waypointQueue_.back().endTime <= footstepObjPoseFuncEndTime_)))
+  {
+    return;
+  }
+  footstepObjPoseFuncEndTime_ = objPoseTime + config_.objHorizon;
+  setObjPoseFuncPoints(*footstepObjPoseFunc_, footstepObjPoseFuncEndTime_);
+}
+
+void ManipManager::startFootstepPlan()
+{
+  if(footstepPlanPendingId_ > 0)
+  {
+    mc_rtc::log::error("[ManipManager] Footstep planning is already running.");
+    return;
+  }
+  if(!initFootstepGenState(footstepPlanRequest_.genState))
+  {
+    return;
+  }
+
+  footstepPlanRequest_.id = ++footstepPlanLastId_;
+  // The snapshot of the waypoint queue in the request buffer is reused if the waypoints have only been appended to the
+  // back or removed from the front of the queue since it was copied, so that only the new waypoints are copied
+  auto & waypointQueue = footstepPlanRequest_.waypointQueue;
+  if(footstepPlanRequest_.waypointQueueGen == waypointQueueGen_)
+  {
+    size_t popNum = std::min(waypointPopCount_ - footstepPlanRequest_.waypointPopCount, waypointQueue.size());
+    waypointQueue.erase(waypointQueue.begin(), waypointQueue.begin() + static_cast<std::ptrdiff_t>(popNum));
+  }
+  else
+  {
+    waypointQueue.clear();
+    footstepPlanRequest_.waypointQueueGen = waypointQueueGen_;
+  }
+  footstepPlanRequest_.waypointPopCount = waypointPopCount_;
+  footstepPlanRequest_.lastWaypointPose = lastWaypointPose_;
+  footstepPlanRequest_.t = ctl().t();
+  footstepPlanRequest_.objHorizon = config_.objHorizon;
+  footstepPlanRequest_.objHoldDuration = (config_.incrementalObjTraj ? 2.0 : 1.0) * config_.objHorizon;
+
+  footstepPlanWaypointNum_ = waypointQueue_.size();
+  footstepPlanRequestSent_ = false;
+  footstepPlanPendingId_ = footstepPlanRequest_.id;
+  footstepPlanWaitingQueue_ = false;
+  footstepPlanProgress_ = 0.0;
+
+  sendFootstepPlanRequest();
+}
+
+void ManipManager::sendFootstepPlanRequest()
+{
+  // Copy a bounded number of waypoints in each control cycle so that the cost does not depend on the queue length
+  // The waypoints removed from the front of the queue since the copy is started have already been copied
+  constexpr size_t copyNumPerCycle = 256;
+  auto & waypointQueue = footstepPlanRequest_.waypointQueue;
+  size_t popNum = waypointPopCount_ - footstepPlanRequest_.waypointPopCount;
+  if(popNum > waypointQueue.size() || footstepPlanRequest_.waypointQueueGen != waypointQueueGen_)
+  {
+    mc_rtc::log::warning("[ManipManager] Waypoints are modified before they are copied for footstep planning. Generate "
+                         "the footsteps in the control thread instead.");
+    footstepPlanRequest_.waypointQueueGen = 0;
+    footstepPlanPendingId_ = 0;
+    startFootstepGen();
+    return;
+  }
+  size_t copyEndIdx = std::min(waypointQueue.size() + copyNumPerCycle, footstepPlanWaypointNum_);
+  for(size_t i = waypointQueue.size(); i < copyEndIdx; i++)
   {
-    double objPoseTime = startTime + config_.footstepDuration;
-    if(objPoseFunc_->endTime() < objPoseTime)
+    waypointQueue.push_back(waypointQueue_[i - popNum]);
+    waypointVisitNum_++;
+  }
+  if(waypointQueue.size() < footstepPlanWaypointNum_)
+  {
+    return;
+  }
+
+  // Send the request without blocking (retried in the next control cycle if the worker is taking the previous one)
+  // The buffers are swapped so that they are reused without reallocation
+  std::unique_lock<std::mutex> lock(footstepPlanRequestMtx_, std::try_to_lock);
+  if(!lock.owns_lock())
+  {
+    return;
+  }
+  std::swap(footstepPlanRequest_, footstepPlanSharedRequest_);
+  footstepPlanRequested_ = true;
+  lock.unlock();
+  footstepPlanRequestCv_.notify_one();
+  footstepPlanRequestSent_ = true;
+}
+
+void ManipManager::startFootstepPlanThread()
+{
+  footstepPlanRequested_ = false;
+  footstepPlanStopRequested_ = false;
+  footstepPlanCancelRequested_ = false;
+  footstepPlanDone_ = false;
+  footstepPlanPendingId_ = 0;
+  footstepPlanProgress_ = 0.0;
+
+  footstepPlanThread_ = std::thread(&ManipManager::footstepPlanLoop, this);
+}
+
+void ManipManager::stopFootstepPlanThread()
+{
+  footstepPlanPendingId_ = 0;
+
+  if(!footstepPlanThread_.joinable())
+  {
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(footstepPlanRequestMtx_);
+    footstepPlanStopRequested_ = true;
+    footstepPlanCancelRequested_ = true;
+  }
+  footstepPlanRequestCv_.notify_one();
+  footstepPlanThread_.join();
+}
+
+void ManipManager::footstepPlanLoop()
+{
+  FootstepPlanData & data = footstepPlanData_;
+
+  while(true)
+  {
+    // Take the request by swapping the buffers so that they are reused without reallocation
     {
-      objPoseTime = objPoseFunc_->endTime();
+      std::unique_lock<std::mutex> lock(footstepPlanRequestMtx_);
+      footstepPlanRequestCv_.wait(lock, [this]() { return footstepPlanRequested_ || footstepPlanStopRequested_; });
+      if(footstepPlanStopRequested_)
+      {
+        return;
+      }
+      std::swap(data, footstepPlanSharedRequest_);
+      footstepPlanRequested_ = false;
+      footstepPlanCancelRequested_ = false;
     }
-    Eigen::Vector3d deltaTrans =
-        convertTo2d(config_.objToFootMidTrans * calcRefObjPose(objPoseTime) * footMidpose.inv());
-    footMidpose = convertTo3d(ctl().footManager_->clampDeltaTrans(deltaTrans, foot)) * footMidpose;
-    const auto & footstep = makeFootstep(foot, footMidpose, startTime);
+
+    {
+      LMC_TRACE_SCOPE("ManipManager::footstepPlan");
+
+      setObjPoseFuncPoints(*footstepPlanObjPoseFunc_, data.waypointQueue, data.lastWaypointPose, data.t,
+                           interpMaxTime_, data.objHorizon, data.objHoldDuration);
+
+      data.footsteps.clear();
+      double planStartTime = data.genState.startTime;
+      double planDuration = std::max(data.genState.endTime - planStartTime, 1e-6);
+      while(data.genState.active && !footstepPlanCancelRequested_.load(std::memory_order_relaxed))
+      {
+        data.footsteps.push_back(calcNextFootstep(data.genState, *footstepPlanObjPoseFunc_));
+        footstepPlanProgress_.store(std::clamp((data.genState.startTime - planStartTime) / planDuration, 0.0, 1.0),
+                                    std::memory_order_relaxed);
+      }
+    }
+
+    // Publish the result by swapping the buffers
+    {
+      std::lock_guard<std::mutex> lock(footstepPlanResultMtx_);
+      std::swap(data, footstepPlanResult_);
+    }
+    footstepPlanDone_.store(true, std::memory_order_release);
+  }
+}
+
+void ManipManager::handOffFootstepPlan()
+{
+  // Receive the result without blocking (retried in the next control cycle if the worker is publishing it)
+  std::unique_lock<std::mutex> lock(footstepPlanResultMtx_, std::try_to_lock);
+  if(!lock.owns_lock())
+  {
+    return;
+  }
+
+  // Ignore the result of the canceled request
+  const FootstepPlanData & result = footstepPlanResult_;
+  if(result.id != footstepPlanPendingId_)
+  {
+    footstepPlanDone_ = false;
+    return;
+  }
+
+  // Keep the plan until the footstep queue becomes empty
+  if(!ctl().footManager_->footstepQueue().empty())
+  {
+    if(!footstepPlanWaitingQueue_)
+    {
+      footstepPlanWaitingQueue_ = true;
+      mc_rtc::log::warning("[ManipManager] Wait for the footstep queue to become empty to append the footstep plan.");
+    }
+    return;
+  }
+
+  footstepPlanDone_ = false;
+  footstepPlanPendingId_ = 0;
+  footstepPlanWaitingQueue_ = false;
+
+  if(result.genState.active || result.footsteps.empty())
+  {
+    mc_rtc::log::error("[ManipManager] Footstep planning is not finished.");
+    return;
+  }
+
+  // Generate the footsteps in the control thread if planning took so long that the first footstep has already started
+  if(result.footsteps.front().transitStartTime < ctl().t())
+  {
+    mc_rtc::log::warning("[ManipManager] The footstep plan is finished too late: {} < {}. Generate the footsteps in "
+                         "the control thread instead.",
+                         result.footsteps.front().transitStartTime, ctl().t());
+    lock.unlock();
+    startFootstepGen();
+    return;
+  }
+
+  for(const auto & footstep : result.footsteps)
+  {
     ctl().footManager_->appendFootstep(footstep);
+  }
+  footstepPlanProgress_ = 1.0;
+}
 
-    foot = opposite(foot);
-    startTime = footstep.transitEndTime;
+void ManipManager::cancelFootstepPlan()
+{
+  if(footstepPlanPendingId_ == 0)
+  {
+    return;
   }
-  const auto & footstep = makeFootstep(foot, footMidpose, startTime);
-  ctl().footManager_->appendFootstep(footstep);
+  footstepPlanPendingId_ = 0;
+  footstepPlanWaitingQueue_ = false;
+
+  // Discard the request not taken by the background thread yet, and stop the planning being processed
+  std::lock_guard<std::mutex> lock(footstepPlanRequestMtx_);
+  footstepPlanRequested_ = false;
+  footstepPlanCancelRequested_ = true;
 }
 
 void ManipManager::updateForVelMode()
 {
+  LMC_TRACE_SCOPE("ManipManager::updateForVelMode");
+
   auto convertTo2d = [](const sva::PTransformd & pose) -> Eigen::Vector3d {
     return Eigen::Vector3d(pose.translation().x(), pose.translation().y(), mc_rbdyn::rpyFromMat(pose.rotation()).z());
   };
@@ -752,57 +1469,222 @@ void ManipManager::updateForVelMode()
   };
 
   const auto & frontFootstep = ctl().footManager_->footstepQueue().front();
+  const VelProfile & velProfile = velModeData_.velProfile_;
+  double footstepDuration = ctl().footManager_->config().footstepDuration;
+
+  // Set the current velocity for the GUI and the logger
+  if(velProfile.pointNum > 0)
+  {
+    velModeData_.targetVel_ = velProfile.velAt(ctl().t());
+  }
+
+  // If the footsteps are updated online in FootManager, the front footstep is also updated until its swing starts
+  // In this case, the front footstep is planned from the support foot, and the corresponding waypoint is updated
+  bool updateFrontFootstep = ctl().footManager_->velModeData().config_.enableOnlineFootstepUpdate
+                             && ctl().t() < frontFootstep.swingStartTime;
+
+  // The waypoints planned ahead along the velocity profile are removed here and added again after planning when the
+  // profile or the reference footstep changes
+  bool updatePreview = velModeData_.requirePreview_ || velModeData_.frontFootstep_ != &frontFootstep
+                       || (updateFrontFootstep && velProfile.pointNum > 0);
+  if(updatePreview)
+  {
+    velModeData_.requirePreview_ = false;
+    removeVelModePreview();
+  }
 
   // When the front footstep of queue switches to the next one, the corresponding waypoint is added to the queue
   if(velModeData_.frontFootstep_ != &frontFootstep)
   {
     velModeData_.frontFootstep_ = &frontFootstep;
+    velModeData_.prevWaypointPose_ = velModeData_.frontWaypointPose_;
     velModeData_.frontWaypointPose_ = convertTo3d(velModeData_.objDeltaTrans_) * velModeData_.frontWaypointPose_;
     appendWaypoint(Waypoint(std::max(frontFootstep.transitStartTime, ctl().t()), frontFootstep.transitEndTime,
                             velModeData_.frontWaypointPose_));
   }
 
-  // Assuming that the front footstep of queue is fixed, find the objDeltaTrans where the next footstep is in
-  // reachability (i.e., not changed by clampDeltaTrans)
-  {
-    sva::PTransformd frontFootMidpose =
-        ctl().footManager_->config().midToFootTranss.at(frontFootstep.foot).inv() * frontFootstep.pose;
+  // Assuming that the reference footstep is fixed, find the largest objDeltaTrans along the target velocity where the
+  // next footstep is in reachability (i.e., not changed by clampDeltaTrans)
+  auto calcStep = [&](const Foot & refFoot, const sva::PTransformd & refFootMidpose,
+                      const sva::PTransformd & refWaypointPose, double stepStartTime, Eigen::Vector3d & objDeltaTrans,
+                      Eigen::Vector3d & footstepDeltaTrans) {
     auto calcFootstepDeltaTrans = [&](const Eigen::Vector3d & _objDeltaTrans) {
-      sva::PTransformd newWaypointPose = convertTo3d(_objDeltaTrans) * velModeData_.frontWaypointPose_;
+      sva::PTransformd newWaypointPose = convertTo3d(_objDeltaTrans) * refWaypointPose;
       sva::PTransformd nextFootMidpose = config_.objToFootMidTrans * newWaypointPose;
-      return convertTo2d(nextFootMidpose * frontFootMidpose.inv());
+      return convertTo2d(nextFootMidpose * refFootMidpose.inv());
     };
-    constexpr size_t searchNum = 10;
-    constexpr double reduceRatio = 0.8;
     constexpr double clampDeltaTransThre = 1e-6;
-    Eigen::Vector3d footstepDeltaTrans;
-    Eigen::Vector3d objDeltaTrans = ctl().footManager_->config().footstepDuration * velModeData_.targetVel_;
-    for(size_t i = 1; i <= searchNum; i++)
+    auto isFeasible = [&](const Eigen::Vector3d & _footstepDeltaTrans) {
+      Eigen::Vector3d footstepDeltaTransClamped =
+          ctl().footManager_->clampDeltaTrans(_footstepDeltaTrans, opposite(refFoot));
+      return (_footstepDeltaTrans - footstepDeltaTransClamped).norm() < clampDeltaTransThre;
+    };
+
+    Eigen::Vector3d maxObjDeltaTrans = integrateRelativeVel(stepStartTime, stepStartTime + footstepDuration);
+    objDeltaTrans = maxObjDeltaTrans;
+    footstepDeltaTrans = calcFootstepDeltaTrans(objDeltaTrans);
+    if(isFeasible(footstepDeltaTrans))
     {
-      if(i == searchNum)
+      return;
+    }
+
+    // Bisection on the scale of objDeltaTrans, keeping the lower bound feasible
+    double feasibleScale = 0.0;
+    double infeasibleScale = 1.0;
+    objDeltaTrans.setZero();
+    footstepDeltaTrans = calcFootstepDeltaTrans(objDeltaTrans);
+    if(!isFeasible(footstepDeltaTrans))
+    {
+      // Stop the feet if the footstep is not reachable even without moving the object
+      footstepDeltaTrans.setZero();
+      return;
+    }
+    for(int i = 0; i < velModeData_.config_.feasibleStepSearchNum; i++)
+    {
+      double scale = 0.5 * (feasibleScale + infeasibleScale);
+      Eigen::Vector3d footstepDeltaTransTmp = calcFootstepDeltaTrans(scale * maxObjDeltaTrans);
+      if(isFeasible(footstepDeltaTransTmp))
+      {
+        feasibleScale = scale;
+        footstepDeltaTrans = footstepDeltaTransTmp;
+      }
+      else
       {
-        objDeltaTrans.setZero();
-        footstepDeltaTrans.setZero();
-        break;
+        infeasibleScale = scale;
       }
+    }
+    objDeltaTrans = feasibleScale * maxObjDeltaTrans;
+  };
 
-      footstepDeltaTrans = calcFootstepDeltaTrans(objDeltaTrans);
-      Eigen::Vector3d footstepDeltaTransClamped =
-          ctl().footManager_->clampDeltaTrans(footstepDeltaTrans, opposite(frontFootstep.foot));
-      if((footstepDeltaTrans - footstepDeltaTransClamped).norm() < clampDeltaTransThre)
+  // The reference footstep is the front footstep of queue, or the support foot if the front footstep is updated
+  Foot refFoot = updateFrontFootstep ? opposite(frontFootstep.foot) : frontFootstep.foot;
+  const sva::PTransformd & refFootPose =
+      updateFrontFootstep ? ctl().footManager_->targetFootPose(refFoot) : frontFootstep.pose;
+  sva::PTransformd refFootMidpose = ctl().footManager_->config().midToFootTranss.at(refFoot).inv() * refFootPose;
+  sva::PTransformd refWaypointPose =
+      updateFrontFootstep ? velModeData_.prevWaypointPose_ : velModeData_.frontWaypointPose_;
+  double stepStartTime = updateFrontFootstep ? frontFootstep.transitStartTime : frontFootstep.transitEndTime;
+
+  // Plan the footsteps ahead until the end time of the velocity profile, each of which is the reference of the next one
+  // FootManager takes the relative velocity of the first footstep, and the waypoints of the others are added to the
+  // queue
+  int stepNum = 1;
+  if(updatePreview && velProfile.pointNum > 0)
+  {
+    while(stepNum <= velModeData_.config_.maxPreviewStepNum
+          && stepStartTime + stepNum * footstepDuration < velProfile.endTime())
+    {
+      stepNum++;
+    }
+  }
+  for(int i = 0; i < stepNum; i++)
+  {
+    Eigen::Vector3d objDeltaTrans;
+    Eigen::Vector3d footstepDeltaTrans;
+    calcStep(refFoot, refFootMidpose, refWaypointPose, stepStartTime, objDeltaTrans, footstepDeltaTrans);
+    sva::PTransformd waypointPose = convertTo3d(objDeltaTrans) * refWaypointPose;
+
+    if(i == 0)
+    {
+      velModeData_.objDeltaTrans_ = objDeltaTrans;
+      ctl().footManager_->setRelativeVel(footstepDeltaTrans / footstepDuration);
+
+      // Update the waypoint corresponding to the front footstep
+      if(updateFrontFootstep && !waypointQueue_.empty())
       {
-        break;
+        velModeData_.frontWaypointPose_ = waypointPose;
+        updateStartedWaypoint(waypointPose);
       }
-      else
+    }
+
+    if(updatePreview && velProfile.pointNum > 0 && !(i == 0 && updateFrontFootstep)
+       && stepStartTime < velProfile.endTime())
+    {
+      if(appendWaypoint(Waypoint(stepStartTime, stepStartTime + footstepDuration, waypointPose)))
       {
-        objDeltaTrans *= reduceRatio;
+        velModeData_.previewWaypointNum_++;
       }
     }
-    velModeData_.objDeltaTrans_ = objDeltaTrans;
-    ctl().footManager_->setRelativeVel(footstepDeltaTrans / ctl().footManager_->config().footstepDuration);
+
+    refFoot = opposite(refFoot);
+    refFootMidpose = convertTo3d(footstepDeltaTrans) * refFootMidpose;
+    refWaypointPose = waypointPose;
+    stepStartTime += footstepDuration;
   }
 }
 
+void ManipManager::updateStartedWaypoint(const sva::PTransformd & pose)
+{
+  constexpr double poseChangeThre = 1e-10;
+  Waypoint & backWaypoint = waypointQueue_.back();
+  if(sva::transformError(backWaypoint.pose, pose).vector().norm() < poseChangeThre)
+  {
+    return;
+  }
+
+  // If the object has already started to move toward the waypoint, overwriting its pose makes the reference object
+  // pose jump, so a new segment is started from the current reference object pose instead
+  if(backWaypoint.startTime < ctl().t())
+  {
+    // The waypoints before the last one have been completed in the velocity mode
+    while(waypointQueue_.size() > 1 && waypointQueue_.front().endTime <= ctl().t())
+    {
+      waypointQueue_.pop_front();
+      waypointPopCount_++;
+    }
+    if(waypointQueue_.size() > 1)
+    {
+      return;
+    }
+    lastWaypointPose_ = calcRefObjPose(ctl().t());
+    backWaypoint.startTime = ctl().t();
+  }
+
+  backWaypoint.pose = pose;
+  waypointQueueGen_++;
+  requireObjPoseFuncUpdate_ = true;
+}
+
+void ManipManager::removeVelModePreview()
+{
+  size_t previewWaypointNum = std::min(velModeData_.previewWaypointNum_, waypointQueue_.size());
+  for(size_t i = 0; i < previewWaypointNum; i++)
+  {
+    waypointQueue_.pop_back();
+  }
+  if(previewWaypointNum > 0)
+  {
+    waypointQueueGen_++;
+    requireObjPoseFuncUpdate_ = true;
+  }
+  velModeData_.previewWaypointNum_ = 0;
+}
+
+Eigen::Vector3d ManipManager::FootstepGenConfig::clampDeltaTrans(const Eigen::Vector3d & deltaTrans,
+                                                                 const Foot & foot) const
+{
+  Eigen::Vector3d deltaTransMax = deltaTransLimit;
+  Eigen::Vector3d deltaTransMin = -1 * deltaTransLimit;
+  if(foot == Foot::Left)
+  {
+    deltaTransMin.y() = 0;
+  }
+  else
+  {
+    deltaTransMax.y() = 0;
+  }
+  return deltaTrans.cwiseMax(deltaTransMin).cwiseMin(deltaTransMax);
+}
+
+Footstep ManipManager::FootstepGenConfig::makeFootstep(const Foot & foot,
+                                                       const sva::PTransformd & footMidpose,
+                                                       double startTime) const
+{
+  return Footstep(foot, midToFootTranss.at(foot) * footMidpose, startTime,
+                  startTime + 0.5 * doubleSupportRatio * footstepDuration,
+                  startTime + (1.0 - 0.5 * doubleSupportRatio) * footstepDuration, startTime + footstepDuration);
+}
+
 Footstep ManipManager::makeFootstep(const Foot & foot,
                                     const sva::PTransformd & footMidpose,
                                     double startTime,
@@ -814,24 +1696,107 @@ Footstep ManipManager::makeFootstep(const Foot & foot,
                   startTime + config_.footstepDuration, swingTrajConfig);
 }
 
+void ManipManager::updateRealObj()
+{
+  // Update object velocity
+  ObjVelMsgData objVelMsgData;
+  if(objVelBuffer_.read(objVelMsgData))
+  {
+    const auto & angular = objVelMsgData.angular;
+    const auto & linear = objVelMsgData.linear;
+    sva::MotionVecd vel(Eigen::Vector3d(angular[0], angular[1], angular[2]),
+                        Eigen::Vector3d(linear[0], linear[1], linear[2]));
+    ctl().realObj().velW(vel);
+    objVelReceived_ = true;
+  }
+
+  // Update object pose
+  ObjPoseMsgData objPoseMsgData;
+  bool objPoseReceived = objPoseBuffer_.read(objPoseMsgData);
+  if(objPoseReceived)
+  {
+    const auto & position = objPoseMsgData.position;
+    const auto & orientation = objPoseMsgData.orientation;
+    sva::PTransformd pose(Eigen::Quaterniond(orientation[0], orientation[1], orientation[2], orientation[3])
+                              .normalized()
+                              .toRotationMatrix()
+                              .transpose(),
+                          Eigen::Vector3d(position[0], position[1], position[2]));
+
+    // Messages without time stamp are assumed to have no latency and are applied without the history
+    if(objPoseMsgData.stamp <= 0.0)
+    {
+      objPoseHistory_.clear();
+      objPoseLatency_ = 0.0;
+      ctl().realObj().posW(pose);
+      return;
+    }
+
+    // Restart the history if the time stamp goes backward (e.g., when the publisher is restarted)
+    if(!objPoseHistory_.push(objPoseMsgData.stamp, pose))
+    {
+      mc_rtc::log::warning("[ManipManager] Time stamp of the object pose goes backward: {} <= {}. Clear the history.",
+                           objPoseMsgData.stamp, objPoseHistory_.latestStamp());
+      objPoseHistory_.clear();
+      objPoseHistory_.push(objPoseMsgData.stamp, pose);
+    }
+  }
+  if(objPoseHistory_.empty())
+  {
+    return;
+  }
+
+  double latestStamp = objPoseHistory_.latestStamp();
+  double now = ros::Time::now().toSec();
+  objPoseLatency_ = now - latestStamp;
+
+  if(!config_.objLatencyCompensation)
+  {
+    if(objPoseReceived)
+    {
+      ctl().realObj().posW(objPoseHistory_.latestPose());
+    }
+  }
+  else if(objVelReceived_ && latestStamp <= now)
+  {
+    // Extrapolate with the measured velocity
+    double extrapDuration = std::min(now - latestStamp, config_.maxObjExtrapolationDuration);
+    const sva::PTransformd & latestPose = objPoseHistory_.latestPose();
+    const sva::MotionVecd & vel = ctl().realObj().velW();
+    Eigen::Matrix3d deltaRot = Eigen::Matrix3d::Identity();
+    double angularVelNorm = vel.angular().norm();
+    if(angularVelNorm > 1e-10)
+    {
+      deltaRot = Eigen::AngleAxisd(extrapDuration * angularVelNorm, vel.angular() / angularVelNorm).toRotationMatrix();
+    }
+    // Note that the rotation of sva::PTransformd is the transpose of the rotation matrix
+    ctl().realObj().posW(sva::PTransformd(latestPose.rotation() * deltaRot.transpose(),
+                                          latestPose.translation() + extrapDuration * vel.linear()));
+  }
+  else
+  {
+    ctl().realObj().posW(objPoseHistory_.calcPose(now, config_.maxObjExtrapolationDuration));
+  }
+}
+
 void ManipManager::objPoseCallback(const geometry_msgs::PoseStamped::ConstPtr & poseStMsg)
 {
-  // Update real object pose
+  // Store object pose, which is set to the real object in updateRealObj
   const auto & poseMsg = poseStMsg->pose;
-  sva::PTransformd pose(
-      Eigen::Quaterniond(poseMsg.orientation.w, poseMsg.orientation.x, poseMsg.orientation.y, poseMsg.orientation.z)
-          .normalized()
-          .toRotationMatrix()
-          .transpose(),
-      Eigen::Vector3d(poseMsg.position.x, poseMsg.position.y, poseMsg.position.z));
-  ctl().realObj().posW(pose);
+  ObjPoseMsgData objPoseMsgData;
+  objPoseMsgData.stamp = poseStMsg->header.stamp.toSec();
+  objPoseMsgData.position = {poseMsg.position.x, poseMsg.position.y, poseMsg.position.z};
+  objPoseMsgData.orientation = {poseMsg.orientation.w, poseMsg.orientation.x, poseMsg.orientation.y,
+                                poseMsg.orientation.z};
+  objPoseBuffer_.write(objPoseMsgData);
 }
 
 void ManipManager::objVelCallback(const geometry_msgs::TwistStamped::ConstPtr & twistStMsg)
 {
-  // Update real object velocity
+  // Store object velocity, which is set to the real object in updateRealObj
   const auto & twistMsg = twistStMsg->twist;
-  sva::MotionVecd vel(Eigen::Vector3d(twistMsg.angular.x, twistMsg.angular.y, twistMsg.angular.z),
-                      Eigen::Vector3d(twistMsg.linear.x, twistMsg.linear.y, twistMsg.linear.z));
-  ctl().realObj().velW(vel);
+  ObjVelMsgData objVelMsgData;
+  objVelMsgData.angular = {twistMsg.angular.x, twistMsg.angular.y, twistMsg.angular.z};
+  objVelMsgData.linear = {twistMsg.linear.x, twistMsg.linear.y, twistMsg.linear.z};
+  objVelBuffer_.write(objVelMsgData);
 }
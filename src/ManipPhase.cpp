@@ -17,12 +17,18 @@ LocomanipController & Base::ctl()
   return manipManager_->ctl();
 }
 
-Free::Free(const Hand & hand, ManipManager * manipManager) : Base(ManipPhaseLabel::Free, hand, manipManager)
+Free::Free(const Hand & hand, ManipManager * manipManager) : Base(ManipPhaseLabel::Free, hand, manipManager) {}
+
+void Free::start()
 {
   ctl().solver().removeTask(ctl().handTasks_.at(hand_));
 }
 
 PreReach::PreReach(const Hand & hand, ManipManager * manipManager) : Base(ManipPhaseLabel::PreReach, hand, manipManager)
+{
+}
+
+void PreReach::start()
 {
   // Add hand task
   ctl().handTasks_.at(hand_)->reset();
@@ -46,7 +52,8 @@ void PreReach::run()
 
   // Set target pose of hand task
   ctl().handTasks_.at(hand_)->targetPose(manipManager_->config().preReachTranss.at(hand_)
-                                         * manipManager_->config().objToHandTranss.at(hand_) * ctl().obj().posW());
+                                         * manipManager_->config().objToHandTranss.at(hand_)
+                                         * manipManager_->refSnapshot().objPose);
 }
 
 bool PreReach::complete() const
@@ -54,60 +61,60 @@ bool PreReach::complete() const
   return endTime_ <= ctl().t();
 }
 
-std::shared_ptr<Base> PreReach::makeNextManipPhase() const
+ManipPhaseLabel PreReach::nextLabel() const
 {
-  return std::make_shared<Reach>(hand_, manipManager_);
+  return ManipPhaseLabel::Reach;
 }
 
-Reach::Reach(const Hand & hand, ManipManager * manipManager) : Base(ManipPhaseLabel::Reach, hand, manipManager)
+Reach::Reach(const Hand & hand, ManipManager * manipManager) : Base(ManipPhaseLabel::Reach, hand, manipManager) {}
+
+void Reach::start()
 {
   // Set stiffness of hand task
   ctl().handTasks_.at(hand_)->stiffness(manipManager_->config().handTaskStiffness);
 
   // Setup reaching interpolation
-  reachingRatioFunc_ = std::make_shared<TrajColl::CubicInterpolator<double>>(
-      std::map<double, double>{{ctl().t(), 0.0}, {ctl().t() + manipManager_->config().reachDuration, 1.0}});
+  startTime_ = ctl().t();
+  duration_ = manipManager_->config().reachDuration;
+  reaching_ = true;
 }
 
 void Reach::run()
 {
   // Set target pose of hand task
-  if(reachingRatioFunc_)
+  if(reaching_)
   {
-    double reachingRatio = 0.0;
-    if(ctl().t() < reachingRatioFunc_->endTime())
+    double reachingRatio = calcReachingRatio(ctl().t(), startTime_, duration_);
+    if(startTime_ + duration_ <= ctl().t())
     {
-      reachingRatio = (*reachingRatioFunc_)(ctl().t());
-    }
-    else
-    {
-      reachingRatio = (*reachingRatioFunc_)(reachingRatioFunc_->endTime());
-      reachingRatioFunc_.reset();
+      reaching_ = false;
     }
     ctl().handTasks_.at(hand_)->targetPose(
         sva::interpolate(manipManager_->config().preReachTranss.at(hand_), sva::PTransformd::Identity(), reachingRatio)
-        * manipManager_->config().objToHandTranss.at(hand_) * ctl().obj().posW());
+        * manipManager_->config().objToHandTranss.at(hand_) * manipManager_->refSnapshot().objPose);
   }
 }
 
 bool Reach::complete() const
 {
-  return !reachingRatioFunc_;
+  return !reaching_;
 }
 
-std::shared_ptr<Base> Reach::makeNextManipPhase() const
+ManipPhaseLabel Reach::nextLabel() const
 {
   if(manipManager_->config().graspCommands.empty())
   {
-    return std::make_shared<Hold>(hand_, manipManager_);
+    return ManipPhaseLabel::Hold;
   }
   else
   {
-    return std::make_shared<Grasp>(hand_, manipManager_);
+    return ManipPhaseLabel::Grasp;
   }
 }
 
-Grasp::Grasp(const Hand & hand, ManipManager * manipManager) : Base(ManipPhaseLabel::Grasp, hand, manipManager)
+Grasp::Grasp(const Hand & hand, ManipManager * manipManager) : Base(ManipPhaseLabel::Grasp, hand, manipManager) {}
+
+void Grasp::start()
 {
   // Send gripper commands
   for(const auto & gripperCommandConfig : manipManager_->config().graspCommands)
@@ -118,7 +125,8 @@ Grasp::Grasp(const Hand & hand, ManipManager * manipManager) : Base(ManipPhaseLa
 
 void Grasp::run()
 {
-  ctl().handTasks_.at(hand_)->targetPose(manipManager_->config().objToHandTranss.at(hand_) * ctl().obj().posW());
+  ctl().handTasks_.at(hand_)->targetPose(manipManager_->config().objToHandTranss.at(hand_)
+                                         * manipManager_->refSnapshot().objPose);
 }
 
 bool Grasp::complete() const
@@ -133,19 +141,22 @@ bool Grasp::complete() const
   return true;
 }
 
-std::shared_ptr<Base> Grasp::makeNextManipPhase() const
+ManipPhaseLabel Grasp::nextLabel() const
 {
-  return std::make_shared<Hold>(hand_, manipManager_);
+  return ManipPhaseLabel::Hold;
 }
 
 Hold::Hold(const Hand & hand, ManipManager * manipManager) : Base(ManipPhaseLabel::Hold, hand, manipManager) {}
 
 void Hold::run()
 {
-  ctl().handTasks_.at(hand_)->targetPose(manipManager_->config().objToHandTranss.at(hand_) * ctl().obj().posW());
+  ctl().handTasks_.at(hand_)->targetPose(manipManager_->config().objToHandTranss.at(hand_)
+                                         * manipManager_->refSnapshot().objPose);
 }
 
-Ungrasp::Ungrasp(const Hand & hand, ManipManager * manipManager) : Base(ManipPhaseLabel::Ungrasp, hand, manipManager)
+Ungrasp::Ungrasp(const Hand & hand, ManipManager * manipManager) : Base(ManipPhaseLabel::Ungrasp, hand, manipManager) {}
+
+void Ungrasp::start()
 {
   // Send gripper commands
   for(const auto & gripperCommandConfig : manipManager_->config().ungraspCommands)
@@ -156,7 +167,8 @@ Ungrasp::Ungrasp(const Hand & hand, ManipManager * manipManager) : Base(ManipPha
 
 void Ungrasp::run()
 {
-  ctl().handTasks_.at(hand_)->targetPose(manipManager_->config().objToHandTranss.at(hand_) * ctl().obj().posW());
+  ctl().handTasks_.at(hand_)->targetPose(manipManager_->config().objToHandTranss.at(hand_)
+                                         * manipManager_->refSnapshot().objPose);
 }
 
 bool Ungrasp::complete() const
@@ -171,47 +183,136 @@ bool Ungrasp::complete() const
   return true;
 }
 
-std::shared_ptr<Base> Ungrasp::makeNextManipPhase() const
+ManipPhaseLabel Ungrasp::nextLabel() const
 {
-  return std::make_shared<Release>(hand_, manipManager_);
+  return ManipPhaseLabel::Release;
 }
 
-Release::Release(const Hand & hand, ManipManager * manipManager) : Base(ManipPhaseLabel::Release, hand, manipManager)
+Release::Release(const Hand & hand, ManipManager * manipManager) : Base(ManipPhaseLabel::Release, hand, manipManager) {}
+
+void Release::start()
 {
   // Setup reaching interpolation
-  reachingRatioFunc_ = std::make_shared<TrajColl::CubicInterpolator<double>>(
-      std::map<double, double>{{ctl().t(), 1.0}, {ctl().t() + manipManager_->config().reachDuration, 0.0}});
+  startTime_ = ctl().t();
+  duration_ = manipManager_->config().reachDuration;
+  reaching_ = true;
 }
 
 void Release::run()
 {
   // Set target pose of hand task
-  if(reachingRatioFunc_)
+  if(reaching_)
   {
-    double reachingRatio = 0.0;
-    if(ctl().t() < reachingRatioFunc_->endTime())
+    double reachingRatio = 1.0 - calcReachingRatio(ctl().t(), startTime_, duration_);
+    if(startTime_ + duration_ <= ctl().t())
     {
-      reachingRatio = (*reachingRatioFunc_)(ctl().t());
-    }
-    else
-    {
-      reachingRatio = (*reachingRatioFunc_)(reachingRatioFunc_->endTime());
-      reachingRatioFunc_.reset();
+      reaching_ = false;
     }
     ctl().handTasks_.at(hand_)->targetPose(
         sva::interpolate(manipManager_->config().preReachTranss.at(hand_), sva::PTransformd::Identity(), reachingRatio)
-        * manipManager_->config().objToHandTranss.at(hand_) * ctl().obj().posW());
+        * manipManager_->config().objToHandTranss.at(hand_) * manipManager_->refSnapshot().objPose);
   }
 }
 
 bool Release::complete() const
 {
-  return !reachingRatioFunc_;
+  return !reaching_;
+}
+
+ManipPhaseLabel Release::nextLabel() const
+{
+  return ManipPhaseLabel::Free;
 }
 
-std::shared_ptr<Base> Release::makeNextManipPhase() const
+double LMC::ManipPhase::calcReachingRatio(double t, double startTime, double duration)
 {
-  return std::make_shared<Free>(hand_, manipManager_);
+  if(duration <= 0.0 || startTime + duration <= t)
+  {
+    return 1.0;
+  }
+  double s = std::max((t - startTime) / duration, 0.0);
+  return s * s * (3.0 - 2.0 * s);
+}
+
+Machine::Machine(const Hand & hand, ManipManager * manipManager)
+: free_(hand, manipManager), preReach_(hand, manipManager), reach_(hand, manipManager), grasp_(hand, manipManager),
+  hold_(hand, manipManager), ungrasp_(hand, manipManager), release_(hand, manipManager)
+{
+}
+
+void Machine::start(const ManipPhaseLabel & label)
+{
+  label_ = label;
+
+  switch(label_)
+  {
+    case ManipPhaseLabel::Free:
+      free_.start();
+      break;
+    case ManipPhaseLabel::PreReach:
+      preReach_.start();
+      break;
+    case ManipPhaseLabel::Reach:
+      reach_.start();
+      break;
+    case ManipPhaseLabel::Grasp:
+      grasp_.start();
+      break;
+    case ManipPhaseLabel::Hold:
+      hold_.start();
+      break;
+    case ManipPhaseLabel::Ungrasp:
+      ungrasp_.start();
+      break;
+    case ManipPhaseLabel::Release:
+      release_.start();
+      break;
+    default:
+      mc_rtc::log::error_and_throw("[ManipPhase::Machine] Unsupported manipulation phase label: {}",
+                                   std::to_string(static_cast<int>(label_)));
+  }
+}
+
+void Machine::run()
+{
+  switch(label_)
+  {
+    case ManipPhaseLabel::Free:
+      runPhase(free_);
+      break;
+    case ManipPhaseLabel::PreReach:
+      runPhase(preReach_);
+      break;
+    case ManipPhaseLabel::Reach:
+      runPhase(reach_);
+      break;
+    case ManipPhaseLabel::Grasp:
+      runPhase(grasp_);
+      break;
+    case ManipPhaseLabel::Hold:
+      runPhase(hold_);
+      break;
+    case ManipPhaseLabel::Ungrasp:
+      runPhase(ungrasp_);
+      break;
+    case ManipPhaseLabel::Release:
+      runPhase(release_);
+      break;
+    default:
+      mc_rtc::log::error_and_throw("[ManipPhase::Machine] Unsupported manipulation phase label: {}",
+                                   std::to_string(static_cast<int>(label_)));
+  }
+}
+
+template<class PhaseType>
+void Machine::runPhase(PhaseType & phase)
+{
+  phase.run();
+
+  if(phase.complete())
+  {
+    start(phase.nextLabel());
+  }
 }
 
 std::string std::to_string(const ManipPhaseLabel & label)
@@ -0,0 +1,281 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#include <mc_rtc/ros.h>
+
+#include <nav_msgs/Path.h>
+#include <visualization_msgs/MarkerArray.h>
+
+#include <BaselineWalkingController/FootManager.h>
+
+#include <LocomanipController/CentroidalManager.h>
+#include <LocomanipController/LocomanipController.h>
+#include <LocomanipController/ManipManager.h>
+#include <LocomanipController/PlanPublisher.h>
+
+using namespace LMC;
+
+namespace
+{
+void setPoseMsg(geometry_msgs::Pose & poseMsg, const sva::PTransformd & pose)
+{
+  const Eigen::Vector3d & pos = pose.translation();
+  // Transpose is needed because sva::PTransformd::rotation() is the transpose of the rotation matrix
+  Eigen::Quaterniond quat(pose.rotation().transpose());
+  poseMsg.position.x = pos.x();
+  poseMsg.position.y = pos.y();
+  poseMsg.position.z = pos.z();
+  poseMsg.orientation.w = quat.w();
+  poseMsg.orientation.x = quat.x();
+  poseMsg.orientation.y = quat.y();
+  poseMsg.orientation.z = quat.z();
+}
+} // namespace
+
+void PlanPublisher::Configuration::load(const mc_rtc::Configuration & mcRtcConfig)
+{
+  mcRtcConfig("enabled", enabled);
+  mcRtcConfig("publishRate", publishRate);
+  mcRtcConfig("frameId", frameId);
+  mcRtcConfig("topicNamespace", topicNamespace);
+  mcRtcConfig("bufferSize", bufferSize);
+  mcRtcConfig("maxWaypointNum", maxWaypointNum);
+  mcRtcConfig("maxFootstepNum", maxFootstepNum);
+  mcRtcConfig("maxExtZmpNum", maxExtZmpNum);
+  mcRtcConfig("footstepMarkerSize", footstepMarkerSize);
+}
+
+PlanPublisher::PlanPublisher(LocomanipController * ctlPtr, const mc_rtc::Configuration & mcRtcConfig)
+: ctlPtr_(ctlPtr)
+{
+  config_.load(mcRtcConfig);
+
+  if(config_.publishRate <= 0.0)
+  {
+    mc_rtc::log::error_and_throw("[PlanPublisher] publishRate must be positive: {}", config_.publishRate);
+  }
+  if(config_.bufferSize < 2)
+  {
+    mc_rtc::log::error_and_throw("[PlanPublisher] bufferSize must be at least 2: {}", config_.bufferSize);
+  }
+}
+
+PlanPublisher::~PlanPublisher()
+{
+  stopPublishThread();
+}
+
+void PlanPublisher::reset()
+{
+  stopPublishThread();
+
+  if(!config_.enabled)
+  {
+    return;
+  }
+
+  // Setup ROS
+  if(!nh_)
+  {
+    if(!mc_rtc::ROSBridge::get_node_handle())
+    {
+      mc_rtc::log::warning("[PlanPublisher] ROS is not initialized, so the plan is not published.");
+      return;
+    }
+    nh_ = std::make_shared<ros::NodeHandle>(config_.topicNamespace);
+    objPathPub_ = nh_->advertise<nav_msgs::Path>("object_path", 1);
+    footstepMarkerPub_ = nh_->advertise<visualization_msgs::MarkerArray>("footsteps", 1);
+    extZmpPathPub_ = nh_->advertise<nav_msgs::Path>("ext_zmp_path", 1);
+  }
+
+  // Allocate the snapshots with the maximum sizes so that no memory is allocated in the control thread
+  snapshots_.resize(static_cast<size_t>(config_.bufferSize));
+  for(auto & snapshot : snapshots_)
+  {
+    // One more element for the current object pose
+    snapshot.objPoses.resize(static_cast<size_t>(config_.maxWaypointNum) + 1);
+    snapshot.footsteps.resize(static_cast<size_t>(config_.maxFootstepNum));
+    snapshot.extZmps.resize(static_cast<size_t>(config_.maxExtZmpNum));
+  }
+  writeCount_ = 0;
+  readCount_ = 0;
+  droppedNum_ = 0;
+
+  decimation_ = std::max(static_cast<int>(std::round(1.0 / (config_.publishRate * ctl().dt()))), 1);
+  // Take the first snapshot in the first control cycle
+  updateCount_ = decimation_ - 1;
+
+  stopRequested_ = false;
+  publishThread_ = std::thread(&PlanPublisher::publishLoop, this);
+}
+
+void PlanPublisher::update()
+{
+  if(!publishThread_.joinable() || ++updateCount_ < decimation_)
+  {
+    return;
+  }
+  updateCount_ = 0;
+
+  // Drop the snapshot instead of waiting for the publishing thread if the ring buffer is full
+  size_t writeCount = writeCount_.load(std::memory_order_relaxed);
+  if(writeCount - readCount_.load(std::memory_order_acquire) >= snapshots_.size())
+  {
+    droppedNum_++;
+    return;
+  }
+
+  fillSnapshot(snapshots_[writeCount % snapshots_.size()]);
+  writeCount_.store(writeCount + 1, std::memory_order_release);
+}
+
+void PlanPublisher::stop()
+{
+  stopPublishThread();
+
+  objPathPub_.shutdown();
+  footstepMarkerPub_.shutdown();
+  extZmpPathPub_.shutdown();
+  nh_.reset();
+}
+
+void PlanPublisher::fillSnapshot(Snapshot & snapshot) const
+{
+  snapshot.t = ctl().t();
+
+  // Object path
+  snapshot.objPoses[0] = ctl().manipManager_->refSnapshot().objPoseWithoutOffset;
+  snapshot.objPoseNum = 1;
+  for(const auto & waypoint : ctl().manipManager_->waypointQueue())
+  {
+    if(snapshot.objPoseNum == snapshot.objPoses.size())
+    {
+      break;
+    }
+    snapshot.objPoses[snapshot.objPoseNum++] = waypoint.pose;
+  }
+
+  // Footsteps
+  snapshot.footstepNum = 0;
+  for(const auto & footstep : ctl().footManager_->footstepQueue())
+  {
+    if(snapshot.footstepNum == snapshot.footsteps.size())
+    {
+      break;
+    }
+    auto & plannedFootstep = snapshot.footsteps[snapshot.footstepNum++];
+    plannedFootstep.foot = footstep.foot;
+    plannedFootstep.pose = footstep.pose;
+    plannedFootstep.swingStartTime = footstep.swingStartTime;
+    plannedFootstep.swingEndTime = footstep.swingEndTime;
+  }
+
+  // Reference ext-ZMP (thinned out so that the number of samples does not exceed the maximum)
+  snapshot.extZmpNum = 0;
+  const auto * centroidalManager = dynamic_cast<const CentroidalManager *>(ctl().centroidalManager_.get());
+  if(centroidalManager && !snapshot.extZmps.empty())
+  {
+    const auto & extZmpDataSeq = centroidalManager->extZmpDataSeq();
+    Eigen::Index seqSize = extZmpDataSeq.size();
+    Eigen::Index maxNum = static_cast<Eigen::Index>(snapshot.extZmps.size());
+    Eigen::Index stride = std::max<Eigen::Index>((seqSize + maxNum - 1) / maxNum, 1);
+    for(Eigen::Index i = 0; i < seqSize; i += stride)
+    {
+      auto & extZmp = snapshot.extZmps[snapshot.extZmpNum++];
+      extZmp.x() = extZmpDataSeq.scale(i) * extZmpDataSeq.refZmpX(i) - extZmpDataSeq.offsetX(i);
+      extZmp.y() = extZmpDataSeq.scale(i) * extZmpDataSeq.refZmpY(i) - extZmpDataSeq.offsetY(i);
+      extZmp.z() = extZmpDataSeq.refZmpZ(i);
+    }
+  }
+}
+
+void PlanPublisher::publishLoop()
+{
+  // Messages are reused over the loop to avoid reallocation
+  nav_msgs::Path objPathMsg;
+  visualization_msgs::MarkerArray footstepMarkerMsg;
+  nav_msgs::Path extZmpPathMsg;
+  objPathMsg.header.frame_id = config_.frameId;
+  extZmpPathMsg.header.frame_id = config_.frameId;
+
+  const auto period = std::chrono::duration<double>(1.0 / config_.publishRate);
+  auto nextTime = std::chrono::steady_clock::now();
+
+  while(!stopRequested_)
+  {
+    nextTime += std::chrono::duration_cast<std::chrono::steady_clock::duration>(period);
+    std::this_thread::sleep_until(nextTime);
+
+    // Skip to the latest snapshot
+    size_t writeCount = writeCount_.load(std::memory_order_acquire);
+    size_t readCount = readCount_.load(std::memory_order_relaxed);
+    if(writeCount == readCount)
+    {
+      continue;
+    }
+    const Snapshot & snapshot = snapshots_[(writeCount - 1) % snapshots_.size()];
+    ros::Time stamp = ros::Time::now();
+
+    // Object path
+    objPathMsg.header.stamp = stamp;
+    objPathMsg.poses.resize(snapshot.objPoseNum);
+    for(size_t i = 0; i < snapshot.objPoseNum; i++)
+    {
+      objPathMsg.poses[i].header = objPathMsg.header;
+      setPoseMsg(objPathMsg.poses[i].pose, snapshot.objPoses[i]);
+    }
+
+    // Footsteps (the first marker deletes the markers of the previous message)
+    footstepMarkerMsg.markers.resize(snapshot.footstepNum + 1);
+    footstepMarkerMsg.markers[0].header.frame_id = config_.frameId;
+    footstepMarkerMsg.markers[0].header.stamp = stamp;
+    footstepMarkerMsg.markers[0].action = visualization_msgs::Marker::DELETEALL;
+    for(size_t i = 0; i < snapshot.footstepNum; i++)
+    {
+      const auto & footstep = snapshot.footsteps[i];
+      auto & markerMsg = footstepMarkerMsg.markers[i + 1];
+      markerMsg.header.frame_id = config_.frameId;
+      markerMsg.header.stamp = stamp;
+      markerMsg.ns = "footsteps";
+      markerMsg.id = static_cast<int>(i);
+      markerMsg.type = visualization_msgs::Marker::CUBE;
+      markerMsg.action = visualization_msgs::Marker::ADD;
+      setPoseMsg(markerMsg.pose, footstep.pose);
+      markerMsg.scale.x = config_.footstepMarkerSize.x();
+      markerMsg.scale.y = config_.footstepMarkerSize.y();
+      markerMsg.scale.z = config_.footstepMarkerSize.z();
+      markerMsg.color.r = (footstep.foot == Foot::Left ? 1.0 : 0.0);
+      markerMsg.color.g = 0.0;
+      markerMsg.color.b = (footstep.foot == Foot::Left ? 0.0 : 1.0);
+      markerMsg.color.a = (footstep.swingStartTime <= snapshot.t ? 1.0 : 0.5);
+    }
+
+    // Reference ext-ZMP
+    extZmpPathMsg.header.stamp = stamp;
+    extZmpPathMsg.poses.resize(snapshot.extZmpNum);
+    for(size_t i = 0; i < snapshot.extZmpNum; i++)
+    {
+      extZmpPathMsg.poses[i].header = extZmpPathMsg.header;
+      setPoseMsg(extZmpPathMsg.poses[i].pose, sva::PTransformd(snapshot.extZmps[i]));
+    }
+
+    // Release the slots before publishing
+    readCount_.store(writeCount, std::memory_order_release);
+
+    objPathPub_.publish(objPathMsg);
+    footstepMarkerPub_.publish(footstepMarkerMsg);
+    extZmpPathPub_.publish(extZmpPathMsg);
+  }
+}
+
+void PlanPublisher::stopPublishThread()
+{
+  if(!publishThread_.joinable())
+  {
+    return;
+  }
+
+  stopRequested_ = true;
+  publishThread_.join();
+}
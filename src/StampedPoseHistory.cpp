@@ -0,0 +1,79 @@
+#include <algorithm>
+
+#include <mc_rtc/logging.h>
+
+#include <LocomanipController/StampedPoseHistory.h>
+
+using namespace LMC;
+
+void StampedPoseHistory::clear()
+{
+  headIdx_ = 0;
+  size_ = 0;
+}
+
+bool StampedPoseHistory::push(double stamp, const sva::PTransformd & pose)
+{
+  if(!empty() && stamp <= latestStamp())
+  {
+    return false;
+  }
+
+  if(size_ == capacity)
+  {
+    headIdx_ = ringIdx(1);
+    size_--;
+  }
+  size_t idx = ringIdx(size_);
+  stamps_[idx] = stamp;
+  poses_[idx] = pose;
+  size_++;
+
+  return true;
+}
+
+double StampedPoseHistory::latestStamp() const
+{
+  return stamps_[ringIdx(size_ - 1)];
+}
+
+const sva::PTransformd & StampedPoseHistory::latestPose() const
+{
+  return poses_[ringIdx(size_ - 1)];
+}
+
+sva::PTransformd StampedPoseHistory::calcPose(double t, double maxExtrapDuration) const
+{
+  if(empty())
+  {
+    mc_rtc::log::error_and_throw("[StampedPoseHistory] calcPose is called for the empty history.");
+  }
+
+  // Extrapolate after the latest pose
+  if(latestStamp() <= t)
+  {
+    if(size_ == 1)
+    {
+      return latestPose();
+    }
+    size_t prevIdx = ringIdx(size_ - 2);
+    size_t latestIdx = ringIdx(size_ - 1);
+    double extrapDuration = std::min(t - stamps_[latestIdx], maxExtrapDuration);
+    double ratio = 1.0 + extrapDuration / (stamps_[latestIdx] - stamps_[prevIdx]);
+    return sva::interpolate(poses_[prevIdx], poses_[latestIdx], ratio);
+  }
+
+  // Interpolate between the poses before and after t
+  for(size_t i = size_ - 1; i > 0; i--)
+  {
+    size_t prevIdx = ringIdx(i - 1);
+    if(stamps_[prevIdx] <= t)
+    {
+      size_t nextIdx = ringIdx(i);
+      double ratio = (t - stamps_[prevIdx]) / (stamps_[nextIdx] - stamps_[prevIdx]);
+      return sva::interpolate(poses_[prevIdx], poses_[nextIdx], ratio);
+    }
+  }
+
+  return poses_[ringIdx(0)];
+}
@@ -0,0 +1,83 @@
+#include <algorithm>
+#include <cmath>
+
+#include <mc_rtc/gui/Label.h>
+#include <mc_rtc/logging.h>
+
+#include <LocomanipController/TimingHistogram.h>
+
+using namespace LMC;
+
+namespace
+{
+//! Logarithm of the ratio between the upper and lower bounds of a bin
+const double logBinRatio = std::log(TimingHistogram::maxDuration / TimingHistogram::minDuration)
+                           / static_cast<double>(TimingHistogram::binNum);
+} // namespace
+
+void TimingHistogram::reset(double deadline)
+{
+  binCounts_.fill(0);
+  count_ = 0;
+  latest_ = 0.0;
+  max_ = 0.0;
+  deadline_ = deadline;
+  overrunNum_ = 0;
+}
+
+void TimingHistogram::add(double duration)
+{
+  size_t binIdx = 0;
+  if(duration > minDuration)
+  {
+    binIdx = std::min(static_cast<size_t>(std::log(duration / minDuration) / logBinRatio), binNum - 1);
+  }
+  binCounts_[binIdx]++;
+  count_++;
+
+  latest_ = duration;
+  max_ = std::max(max_, duration);
+  if(deadline_ > 0.0 && duration > deadline_)
+  {
+    overrunNum_++;
+  }
+}
+
+double TimingHistogram::percentile(double ratio) const
+{
+  if(count_ == 0)
+  {
+    return 0.0;
+  }
+
+  size_t rank = std::max(static_cast<size_t>(std::ceil(ratio * static_cast<double>(count_))), static_cast<size_t>(1));
+  size_t accumCount = 0;
+  for(size_t i = 0; i < binNum; i++)
+  {
+    accumCount += binCounts_[i];
+    if(accumCount >= rank)
+    {
+      return std::min(minDuration * std::exp(logBinRatio * static_cast<double>(i + 1)), max_);
+    }
+  }
+  return max_;
+}
+
+void TimingHistogram::addToLogger(mc_rtc::Logger & logger, const std::string & name, const void * source) const
+{
+  logger.addLogEntry(name + "_latest", source, [this]() { return latest_; });
+  logger.addLogEntry(name + "_p50", source, [this]() { return percentile(0.5); });
+  logger.addLogEntry(name + "_p99", source, [this]() { return percentile(0.99); });
+  logger.addLogEntry(name + "_max", source, [this]() { return max_; });
+  logger.addLogEntry(name + "_overrunNum", source, [this]() { return overrunNum_; });
+}
+
+void TimingHistogram::addToGUI(mc_rtc::gui::StateBuilder & gui,
+                               const std::vector<std::string> & category,
+                               const std::string & name) const
+{
+  gui.addElement(category, mc_rtc::gui::Label(name, [this]() {
+                   return fmt::format("p50 {:.3f} / p99 {:.3f} / max {:.3f} [ms], overrun {}", 1e3 * percentile(0.5),
+                                      1e3 * percentile(0.99), 1e3 * max_, overrunNum_);
+                 }));
+}
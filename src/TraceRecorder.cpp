@@ -0,0 +1,199 @@
+#include <mc_rtc/logging.h>
+
+#include <LocomanipController/TraceRecorder.h>
+
+using namespace LMC;
+
+void TraceRecorder::Configuration::load(const mc_rtc::Configuration & mcRtcConfig)
+{
+  mcRtcConfig("enabled", enabled);
+  mcRtcConfig("filePath", filePath);
+  mcRtcConfig("flushPeriod", flushPeriod);
+}
+
+TraceRecorder & TraceRecorder::instance()
+{
+  static TraceRecorder recorder;
+  return recorder;
+}
+
+TraceRecorder::~TraceRecorder()
+{
+  stop();
+}
+
+bool TraceRecorder::start(const Configuration & config)
+{
+  std::lock_guard<std::mutex> startStopLock(startStopMtx_);
+
+  if(flushThread_.joinable())
+  {
+    if(flushThreadRunning_)
+    {
+      mc_rtc::log::warning("[TraceRecorder] Recording has already been started or is being stopped.");
+      return false;
+    }
+    // The flushing thread of the previous recording has already closed the file
+    flushThread_.join();
+  }
+
+  if(config.flushPeriod <= 0.0)
+  {
+    mc_rtc::log::error("[TraceRecorder] flushPeriod must be positive: {}", config.flushPeriod);
+    return false;
+  }
+  config_ = config;
+
+  // Discard the spans remaining from the previous recording
+  {
+    std::lock_guard<std::mutex> lock(threadBuffersMtx_);
+    for(auto & threadBuffer : threadBuffers_)
+    {
+      threadBuffer->readCount.store(threadBuffer->writeCount.load(std::memory_order_acquire),
+                                    std::memory_order_release);
+    }
+  }
+
+  droppedNum_ = 0;
+
+  stopRequested_ = false;
+  flushThreadRunning_ = true;
+  flushThread_ = std::thread(&TraceRecorder::flushLoop, this);
+  enabled_ = true;
+
+  return true;
+}
+
+void TraceRecorder::stop()
+{
+  std::lock_guard<std::mutex> startStopLock(startStopMtx_);
+
+  requestStop();
+  if(flushThread_.joinable())
+  {
+    flushThread_.join();
+  }
+}
+
+void TraceRecorder::requestStop()
+{
+  enabled_ = false;
+  stopRequested_ = true;
+}
+
+void TraceRecorder::record(const char * name, int64_t startTime, int64_t endTime)
+{
+  ThreadBuffer & buffer = threadBuffer();
+
+  size_t writeCount = buffer.writeCount.load(std::memory_order_relaxed);
+  if(writeCount - buffer.readCount.load(std::memory_order_acquire) >= ThreadBuffer::capacity)
+  {
+    droppedNum_.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+
+  Event & event = buffer.events[writeCount % ThreadBuffer::capacity];
+  event.name = name;
+  event.startTime = startTime;
+  event.endTime = endTime;
+  buffer.writeCount.store(writeCount + 1, std::memory_order_release);
+}
+
+TraceRecorder::ThreadBuffer & TraceRecorder::threadBuffer()
+{
+  thread_local ThreadBufferOwner threadBufferOwner;
+  if(!threadBufferOwner.buffer)
+  {
+    threadBufferOwner.buffer = acquireThreadBuffer();
+  }
+  return *threadBufferOwner.buffer;
+}
+
+std::shared_ptr<TraceRecorder::ThreadBuffer> TraceRecorder::acquireThreadBuffer()
+{
+  // Reuse the buffer released by an exited thread
+  // The spans remaining in the buffer are still written in order because the counts are kept
+  {
+    std::lock_guard<std::mutex> lock(threadBuffersMtx_);
+    for(auto & threadBuffer : threadBuffers_)
+    {
+      if(!threadBuffer->inUse.load(std::memory_order_acquire))
+      {
+        threadBuffer->inUse.store(true, std::memory_order_relaxed);
+        return threadBuffer;
+      }
+    }
+  }
+
+  // Allocate a new buffer without locking the mutex
+  auto threadBuffer = std::make_shared<ThreadBuffer>();
+  threadBuffer->inUse = true;
+  std::lock_guard<std::mutex> lock(threadBuffersMtx_);
+  threadBuffer->tid = static_cast<int>(threadBuffers_.size());
+  threadBuffers_.push_back(threadBuffer);
+  return threadBuffer;
+}
+
+void TraceRecorder::flushLoop()
+{
+  ofs_.open(config_.filePath, std::ios::out | std::ios::trunc);
+  if(!ofs_.is_open())
+  {
+    mc_rtc::log::error("[TraceRecorder] Failed to open the file: {}", config_.filePath);
+    enabled_ = false;
+    flushThreadRunning_ = false;
+    return;
+  }
+  mc_rtc::log::info("[TraceRecorder] Start recording to {}.", config_.filePath);
+
+  // Write in the JSON array format of the trace event format
+  ofs_ << "[\n";
+  firstEvent_ = true;
+
+  const auto period = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+      std::chrono::duration<double>(config_.flushPeriod));
+  auto nextTime = std::chrono::steady_clock::now();
+
+  while(!stopRequested_)
+  {
+    nextTime += period;
+    std::this_thread::sleep_until(nextTime);
+    flush();
+  }
+
+  flush();
+  ofs_ << "\n]\n";
+  ofs_.close();
+
+  mc_rtc::log::info("[TraceRecorder] Stop recording to {} ({} spans dropped).", config_.filePath, droppedNum());
+
+  flushThreadRunning_ = false;
+}
+
+void TraceRecorder::flush()
+{
+  // Copy the buffer list so that threads recording the first span are not blocked by the file writing
+  {
+    std::lock_guard<std::mutex> lock(threadBuffersMtx_);
+    flushBuffers_ = threadBuffers_;
+  }
+
+  for(auto & threadBuffer : flushBuffers_)
+  {
+    size_t writeCount = threadBuffer->writeCount.load(std::memory_order_acquire);
+    size_t readCount = threadBuffer->readCount.load(std::memory_order_relaxed);
+    for(; readCount < writeCount; readCount++)
+    {
+      const Event & event = threadBuffer->events[readCount % ThreadBuffer::capacity];
+      // Complete event with the time stamp and duration in microseconds
+      ofs_ << (firstEvent_ ? "" : ",\n") << "{\"name\":\"" << event.name << "\",\"ph\":\"X\",\"pid\":0,\"tid\":"
+           << threadBuffer->tid << ",\"ts\":" << fmt::format("{:.3f}", 1e-3 * static_cast<double>(event.startTime))
+           << ",\"dur\":" << fmt::format("{:.3f}", 1e-3 * static_cast<double>(event.endTime - event.startTime))
+           << "}";
+      firstEvent_ = false;
+    }
+    threadBuffer->readCount.store(writeCount, std::memory_order_release);
+  }
+
+  ofs_.flush();
+}
@@ -0,0 +1,129 @@
+#include <algorithm>
+#include <cmath>
+
+#include <CCC/Constants.h>
+
+#include <LocomanipController/LocomanipController.h>
+#include <LocomanipController/TraceRecorder.h>
+#include <LocomanipController/centroidal/CentroidalManagerDdpExtZmp.h>
+
+using namespace LMC;
+
+CentroidalManagerDdpExtZmp::CentroidalManagerDdpExtZmp(LocomanipController * ctlPtr,
+                                                       const mc_rtc::Configuration & mcRtcConfig)
+: BWC::CentroidalManager(ctlPtr, mcRtcConfig), LMC::CentroidalManager(ctlPtr, mcRtcConfig),
+  BWC::CentroidalManagerDdpZmp(ctlPtr, mcRtcConfig)
+{
+  horizonSteps_ = static_cast<size_t>(std::floor(config_.horizonDuration / config_.horizonDt));
+}
+
+void CentroidalManagerDdpExtZmp::reset()
+{
+  CentroidalManagerDdpZmp::reset();
+
+  // Limit the number of iterations in each control cycle since the solution is warm-started
+  ddp_->ddp_solver_->config().max_iter = config_.ddpMaxIter;
+
+  lastUList_.clear();
+  lastUListTime_ = 0.0;
+
+  resetExtZmpLog();
+}
+
+void CentroidalManagerDdpExtZmp::addToLogger(mc_rtc::Logger & logger)
+{
+  CentroidalManagerDdpZmp::addToLogger(logger);
+
+  addExtZmpToLogger(logger, config_.name);
+}
+
+void CentroidalManagerDdpExtZmp::runMpc()
+{
+  LMC_TRACE_SCOPE("CentroidalManagerDdpExtZmp::runMpc");
+
+  // Calculate ext-ZMP data over the horizon in one pass; the samples are looked up in calcRefExtZmpData
+  calcExtZmpDataSeq(ctl().t(), config_.horizonDt, static_cast<Eigen::Index>(horizonSteps_) + 1, extZmpDataSeq_);
+  extZmpData_ = extZmpDataSeq_.extZmpData(0);
+
+  updateInitialUList();
+
+  CCC::DdpZmp::InitialParam initialParam;
+  initialParam.pos = mpcCom_;
+  initialParam.vel = mpcComVel_;
+  initialParam.u_list = initialUList_;
+
+  Eigen::Vector3d plannedData =
+      ddp_->planOnce([this](double t) { return calcRefExtZmpData(t); }, initialParam, ctl().t());
+
+  // Remove hand forces effects
+  plannedZmp_ << extZmpData_.applyInv(plannedData.head<2>()), refZmp_.z();
+  plannedForceZ_ = plannedData[2];
+
+  // Store the solution for the warm start in the next control cycle
+  lastUList_ = ddp_->ddp_solver_->controlData().u_list;
+  lastUListTime_ = ctl().t();
+
+  updateExtZmpLog();
+}
+
+Eigen::Vector3d CentroidalManagerDdpExtZmp::calcPlannedComAccel() const
+{
+  // Replace plannedZmp_ with plannedExtZmp
+  Eigen::Vector3d plannedExtZmp;
+  plannedExtZmp << extZmpData_.apply(plannedZmp_.head<2>()), plannedZmp_.z();
+
+  Eigen::Vector3d plannedComAccel;
+  plannedComAccel << plannedForceZ_ / (robotMass_ * (mpcCom_.z() - refZmp_.z()))
+                         * (mpcCom_.head<2>() - plannedExtZmp.head<2>()),
+      plannedForceZ_ / robotMass_;
+  plannedComAccel.z() -= CCC::constants::g;
+  return plannedComAccel;
+}
+
+CCC::DdpZmp::RefData CentroidalManagerDdpExtZmp::calcRefExtZmpData(double t) const
+{
+  // Look up the sequence calculated in runMpc
+  ExtZmpData extZmpData;
+  Eigen::Vector3d refZmp;
+  Eigen::Index idx = extZmpDataSeq_.index(t);
+  if(idx >= 0)
+  {
+    extZmpData = extZmpDataSeq_.extZmpData(idx);
+    refZmp << extZmpDataSeq_.refZmpX(idx), extZmpDataSeq_.refZmpY(idx), extZmpDataSeq_.refZmpZ(idx);
+  }
+  else
+  {
+    extZmpDataSeq_.interpolate(t, extZmpData, refZmp);
+  }
+
+  CCC::DdpZmp::RefData refData;
+  // Add hand forces effects
+  refData.zmp << extZmpData.apply(refZmp.head<2>()), refZmp.z();
+  refData.com_z = refZmp.z() + config_.refComZ;
+  return refData;
+}
+
+void CentroidalManagerDdpExtZmp::updateInitialUList()
+{
+  initialUList_.resize(horizonSteps_);
+
+  if(lastUList_.size() != horizonSteps_)
+  {
+    // Initialize with the reference ext-ZMP and the robot weight
+    for(size_t i = 0; i < horizonSteps_; i++)
+    {
+      Eigen::Index idx = static_cast<Eigen::Index>(i);
+      initialUList_[i] << extZmpDataSeq_.scale(idx) * extZmpDataSeq_.refZmpX(idx) - extZmpDataSeq_.offsetX(idx),
+          extZmpDataSeq_.scale(idx) * extZmpDataSeq_.refZmpY(idx) - extZmpDataSeq_.offsetY(idx),
+          robotMass_ * CCC::constants::g;
+    }
+    return;
+  }
+
+  // Shift the previous solution by the number of elapsed horizon steps
+  size_t shift = static_cast<size_t>(std::max(std::round((ctl().t() - lastUListTime_) / config_.horizonDt), 0.0));
+  for(size_t i = 0; i < horizonSteps_; i++)
+  {
+    initialUList_[i] = lastUList_[std::min(i + shift, horizonSteps_ - 1)];
+  }
+}
@@ -0,0 +1,174 @@
+#include <algorithm>
+#include <cmath>
+
+#include <CCC/Constants.h>
+
+#include <BaselineWalkingController/FootManager.h>
+
+#include <LocomanipController/LocomanipController.h>
+#include <LocomanipController/TraceRecorder.h>
+#include <LocomanipController/centroidal/CentroidalManagerFootGuidedExtZmp.h>
+
+using namespace LMC;
+
+void CentroidalManagerFootGuidedExtZmp::Configuration::load(const mc_rtc::Configuration & mcRtcConfig)
+{
+  BWC::CentroidalManager::Configuration::load(mcRtcConfig);
+
+  mcRtcConfig("horizonDuration", horizonDuration);
+  mcRtcConfig("minTerminalDuration", minTerminalDuration);
+  mcRtcConfig("maxKnotNum", maxKnotNum);
+}
+
+CentroidalManagerFootGuidedExtZmp::CentroidalManagerFootGuidedExtZmp(LocomanipController * ctlPtr,
+                                                                     const mc_rtc::Configuration & mcRtcConfig)
+: BWC::CentroidalManager(ctlPtr, mcRtcConfig), LMC::CentroidalManager(ctlPtr, mcRtcConfig)
+{
+  config_.load(mcRtcConfig);
+
+  if(config_.horizonDuration <= config_.minTerminalDuration)
+  {
+    mc_rtc::log::error_and_throw(
+        "[CentroidalManagerFootGuidedExtZmp] horizonDuration must be greater than minTerminalDuration: {} <= {}",
+        config_.horizonDuration, config_.minTerminalDuration);
+  }
+}
+
+void CentroidalManagerFootGuidedExtZmp::reset()
+{
+  BWC::CentroidalManager::reset();
+
+  // Preallocate the buffers so that no memory is allocated in the control cycles
+  maxKnotNum_ = static_cast<size_t>(std::max(config_.maxKnotNum, 2));
+  knotTimes_.reserve(maxKnotNum_);
+  knotRefExtZmps_.reserve(maxKnotNum_);
+  knotRefDcms_.reserve(maxKnotNum_);
+
+  terminalDuration_ = 0.0;
+  knotNumWarned_ = false;
+
+  resetExtZmpLog();
+}
+
+void CentroidalManagerFootGuidedExtZmp::addToLogger(mc_rtc::Logger & logger)
+{
+  BWC::CentroidalManager::addToLogger(logger);
+
+  addExtZmpToLogger(logger, config_.name);
+
+  logger.addLogEntry(config_.name + "_FootGuided_knotNum", this, [this]() { return knotTimes_.size(); });
+  logger.addLogEntry(config_.name + "_FootGuided_terminalDuration", this, [this]() { return terminalDuration_; });
+  logger.addLogEntry(config_.name + "_FootGuided_refDcm", this, [this]() -> Eigen::Vector2d {
+    return knotRefDcms_.empty() ? Eigen::Vector2d::Zero() : knotRefDcms_.front();
+  });
+}
+
+void CentroidalManagerFootGuidedExtZmp::runMpc()
+{
+  LMC_TRACE_SCOPE("CentroidalManagerFootGuidedExtZmp::runMpc");
+
+  double t = ctl().t();
+  double endTime = t + config_.horizonDuration;
+
+  // Set knots at the current time, the footstep switching times in the horizon, and the end of the horizon
+  // The switching times are added up to maxKnotNum - 1 knots so that the knot of the horizon end is always added
+  // without exceeding the preallocated buffers
+  knotTimes_.clear();
+  knotRefExtZmps_.clear();
+  addKnot(t);
+  extZmpData_ = calcExtZmpData(t);
+  bool knotNumExceeded = false;
+  for(const auto & footstep : ctl().footManager_->footstepQueue())
+  {
+    if(footstep.transitStartTime >= endTime || knotNumExceeded)
+    {
+      break;
+    }
+    for(double switchTime :
+        {footstep.transitStartTime, footstep.swingStartTime, footstep.swingEndTime, footstep.transitEndTime})
+    {
+      if(switchTime >= endTime)
+      {
+        continue;
+      }
+      if(knotTimes_.size() + 1 >= maxKnotNum_)
+      {
+        knotNumExceeded = true;
+        break;
+      }
+      addKnot(switchTime);
+    }
+  }
+  if(knotNumExceeded && !knotNumWarned_)
+  {
+    knotNumWarned_ = true;
+    mc_rtc::log::warning("[CentroidalManagerFootGuidedExtZmp] The switching times in the horizon exceed maxKnotNum "
+                         "({}), and the later ones are ignored.",
+                         config_.maxKnotNum);
+  }
+  addKnot(endTime);
+
+  // Calculate the reference DCM at the knots backward, assuming that the DCM stays at the last reference ext-ZMP
+  // and the reference ext-ZMP is linear between the knots
+  double omega = std::sqrt(CCC::constants::g / config_.refComZ);
+  size_t knotNum = knotTimes_.size();
+  knotRefDcms_.resize(knotNum);
+  knotRefDcms_.back() = knotRefExtZmps_.back();
+  for(size_t i = knotNum - 1; i > 0; i--)
+  {
+    double duration = knotTimes_[i] - knotTimes_[i - 1];
+    double expDuration = std::exp(-omega * duration);
+    const Eigen::Vector2d & startZmp = knotRefExtZmps_[i - 1];
+    const Eigen::Vector2d & endZmp = knotRefExtZmps_[i];
+    knotRefDcms_[i - 1] = expDuration * knotRefDcms_[i] + (1.0 - expDuration) * startZmp
+                          + ((1.0 - expDuration) / (omega * duration) - expDuration) * (endZmp - startZmp);
+  }
+
+  // Select the first switching time that is sufficiently later than the current time as the terminal
+  size_t terminalIdx = 1;
+  while(terminalIdx < knotNum - 1 && knotTimes_[terminalIdx] - t < config_.minTerminalDuration)
+  {
+    terminalIdx++;
+  }
+  terminalDuration_ = knotTimes_[terminalIdx] - t;
+
+  // Foot-guided control law that makes the DCM converge to the reference at the terminal switching time
+  Eigen::Vector2d dcm = mpcCom_.head<2>() + mpcComVel_.head<2>() / omega;
+  double gain = 2.0 / (1.0 - std::exp(-2.0 * omega * terminalDuration_));
+  Eigen::Vector2d plannedExtZmp = knotRefExtZmps_.front() + gain * (dcm - knotRefDcms_.front());
+
+  // Remove hand forces effects
+  plannedZmp_ << extZmpData_.applyInv(plannedExtZmp), refZmp_.z();
+  plannedForceZ_ = robotMass_ * CCC::constants::g;
+
+  updateExtZmpLog();
+}
+
+Eigen::Vector3d CentroidalManagerFootGuidedExtZmp::calcPlannedComAccel() const
+{
+  // Replace plannedZmp_ with plannedExtZmp
+  Eigen::Vector3d plannedExtZmp;
+  plannedExtZmp << extZmpData_.apply(plannedZmp_.head<2>()), plannedZmp_.z();
+
+  Eigen::Vector3d plannedComAccel;
+  plannedComAccel << plannedForceZ_ / (robotMass_ * (mpcCom_.z() - refZmp_.z()))
+                         * (mpcCom_.head<2>() - plannedExtZmp.head<2>()),
+      plannedForceZ_ / robotMass_;
+  plannedComAccel.z() -= CCC::constants::g;
+  return plannedComAccel;
+}
+
+void CentroidalManagerFootGuidedExtZmp::addKnot(double t)
+{
+  // Skip the knots that are too close to the last one to avoid division by zero
+  constexpr double minKnotInterval = 1e-6;
+  if(!knotTimes_.empty() && t < knotTimes_.back() + minKnotInterval)
+  {
+    return;
+  }
+
+  // Add hand forces effects
+  Eigen::Vector3d refZmp = ctl().footManager_->calcRefZmp(t);
+  knotTimes_.push_back(t);
+  knotRefExtZmps_.push_back(calcExtZmpData(t).apply(refZmp.head<2>()));
+}
@@ -1,3 +1,6 @@
+#include <algorithm>
+
+#include <mc_tasks/CoMTask.h>
 #include <mc_tasks/ImpedanceTask.h>
 
 #include <CCC/Constants.h>
@@ -7,28 +10,121 @@
 #include <LocomanipController/LocomanipController.h>
 #include <LocomanipController/ManipManager.h>
 #include <LocomanipController/ManipPhase.h>
+#include <LocomanipController/TraceRecorder.h>
 #include <LocomanipController/centroidal/CentroidalManagerPreviewControlExtZmp.h>
 
 using namespace LMC;
 
+void CentroidalManagerPreviewControlExtZmp::AsyncMpcConfiguration::load(const mc_rtc::Configuration & mcRtcConfig)
+{
+  mcRtcConfig("enabled", enabled);
+  mcRtcConfig("maxStaleDuration", maxStaleDuration);
+}
+
 CentroidalManagerPreviewControlExtZmp::CentroidalManagerPreviewControlExtZmp(LocomanipController * ctlPtr,
                                                                              const mc_rtc::Configuration & mcRtcConfig)
 : BWC::CentroidalManager(ctlPtr, mcRtcConfig), LMC::CentroidalManager(ctlPtr, mcRtcConfig),
   BWC::CentroidalManagerPreviewControlZmp(ctlPtr, mcRtcConfig)
 {
+  if(mcRtcConfig.has("AsyncMpc"))
+  {
+    asyncMpcConfig_.load(mcRtcConfig("AsyncMpc"));
+  }
+  mcRtcConfig("mpcDt", mpcDt_);
+}
+
+CentroidalManagerPreviewControlExtZmp::~CentroidalManagerPreviewControlExtZmp()
+{
+  stopAsyncMpcThread();
+}
+
+void CentroidalManagerPreviewControlExtZmp::reset()
+{
+  CentroidalManagerPreviewControlZmp::reset();
+
+  stopAsyncMpcThread();
+  if(asyncMpcConfig_.enabled)
+  {
+    startAsyncMpcThread();
+  }
+  syncMpc_ = true;
+
+  mpcSolved_ = true;
+  mpcPlanValid_ = false;
+
+  resetExtZmpLog();
 }
 
 void CentroidalManagerPreviewControlExtZmp::addToLogger(mc_rtc::Logger & logger)
 {
   CentroidalManagerPreviewControlZmp::addToLogger(logger);
 
-  logger.addLogEntry(config_.name + "_ExtZmp_scale", this, [this]() { return extZmpData_.scale; });
-  logger.addLogEntry(config_.name + "_ExtZmp_offset", this, [this]() { return extZmpData_.offset; });
+  addExtZmpToLogger(logger, config_.name);
+
+  if(asyncMpcConfig_.enabled)
+  {
+    logger.addLogEntry(config_.name + "_AsyncMpc_sync", this, [this]() { return syncMpc_; });
+    logger.addLogEntry(config_.name + "_AsyncMpc_planAge", this,
+                       [this]() { return asyncMpcResult_.valid ? ctl().t() - asyncMpcResult_.t : 0.0; });
+  }
+
+  if(mpcDt_ > 0.0)
+  {
+    logger.addLogEntry(config_.name + "_MultiRateMpc_solved", this, [this]() { return mpcSolved_; });
+  }
 }
 
 void CentroidalManagerPreviewControlExtZmp::runMpc()
 {
-  extZmpData_ = calcExtZmpData(ctl().t());
+  LMC_TRACE_SCOPE("CentroidalManagerPreviewControlExtZmp::runMpc");
+
+  mpcSolved_ = requireMpcSolve();
+  if(mpcSolved_)
+  {
+    solveMpc();
+
+    // Store the plan for interpolation until the next solve
+    // The sequence of ext-ZMP data starts before the current time if the plan of asynchronous MPC is used
+    mpcPlanValid_ = true;
+    lastMpcTime_ = ctl().t();
+    lastPlannedExtZmp_ = extZmpData_.apply(plannedZmp_.head<2>());
+    ExtZmpData extZmpData;
+    Eigen::Vector3d refZmp;
+    extZmpDataSeq_.interpolate(ctl().t(), extZmpData, refZmp);
+    lastRefExtZmp_ = extZmpData.apply(refZmp.head<2>());
+    lastMpcManipPhaseLabels_ = ctl().manipManager_->refSnapshot().manipPhaseLabels;
+  }
+  else
+  {
+    interpolateMpcPlan();
+  }
+
+  updateExtZmpLog();
+}
+
+void CentroidalManagerPreviewControlExtZmp::solveMpc()
+{
+  Eigen::Index horizonSize = static_cast<Eigen::Index>(std::floor(config_.horizonDuration / config_.horizonDt)) + 1;
+
+  // Use the plan of the worker thread if it is fresh enough, otherwise fall back to synchronous MPC
+  if(asyncMpcThread_.joinable())
+  {
+    syncMpc_ = !runAsyncMpc(horizonSize);
+    if(!syncMpc_)
+    {
+      // Shift the plan by the change of the reference ext-ZMP since the time of the request in the same way as the
+      // interpolation between MPC solves, using the sequence of ext-ZMP data calculated by the worker thread
+      lastPlannedExtZmp_ = asyncMpcResult_.plannedExtZmp;
+      lastRefExtZmp_ << extZmpDataSeq_.scale(0) * extZmpDataSeq_.refZmpX(0) - extZmpDataSeq_.offsetX(0),
+          extZmpDataSeq_.scale(0) * extZmpDataSeq_.refZmpY(0) - extZmpDataSeq_.offsetY(0);
+      interpolateMpcPlan();
+      return;
+    }
+  }
+
+  // Calculate ext-ZMP data over the preview horizon in one pass; the samples are looked up in calcRefData
+  calcExtZmpDataSeq(ctl().t(), config_.horizonDt, horizonSize, extZmpDataSeq_);
+  extZmpData_ = extZmpDataSeq_.extZmpData(0);
 
   // Add hand forces effects
   plannedZmp_.head<2>() = extZmpData_.apply(plannedZmp_.head<2>());
@@ -39,6 +135,44 @@ void CentroidalManagerPreviewControlExtZmp::runMpc()
   plannedZmp_.head<2>() = extZmpData_.applyInv(plannedZmp_.head<2>());
 }
 
+bool CentroidalManagerPreviewControlExtZmp::requireMpcSolve() const
+{
+  if(mpcDt_ <= ctl().dt() || !mpcPlanValid_)
+  {
+    return true;
+  }
+
+  // Solve in the first control cycle after mpcDt_ from the last solve (with a tolerance of half a control cycle)
+  if(ctl().t() >= lastMpcTime_ + mpcDt_ - 0.5 * ctl().dt())
+  {
+    return true;
+  }
+
+  // Solve immediately if the hands holding the object change
+  const auto & manipPhaseLabels = ctl().manipManager_->refSnapshot().manipPhaseLabels;
+  for(const auto & hand : Hands::Both)
+  {
+    if((manipPhaseLabels.at(hand) == ManipPhaseLabel::Hold)
+       != (lastMpcManipPhaseLabels_.at(hand) == ManipPhaseLabel::Hold))
+    {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+void CentroidalManagerPreviewControlExtZmp::interpolateMpcPlan()
+{
+  Eigen::Vector3d refZmp;
+  extZmpDataSeq_.interpolate(ctl().t(), extZmpData_, refZmp);
+
+  // Shift the planned ext-ZMP of the last solve by the change of the reference ext-ZMP
+  Eigen::Vector2d plannedExtZmp = lastPlannedExtZmp_ + extZmpData_.apply(refZmp.head<2>()) - lastRefExtZmp_;
+  plannedZmp_ << extZmpData_.applyInv(plannedExtZmp), refZmp.z();
+  plannedForceZ_ = robotMass_ * CCC::constants::g;
+}
+
 Eigen::Vector3d CentroidalManagerPreviewControlExtZmp::calcPlannedComAccel() const
 {
   // Replace plannedZmp_ with plannedExtZmp
@@ -55,51 +189,144 @@ Eigen::Vector3d CentroidalManagerPreviewControlExtZmp::calcPlannedComAccel() con
 
 Eigen::Vector2d CentroidalManagerPreviewControlExtZmp::calcRefData(double t) const
 {
+  LMC_TRACE_SCOPE("CentroidalManagerPreviewControlExtZmp::calcRefData");
+
+  // Look up the sequence calculated in runMpc
+  Eigen::Index idx = extZmpDataSeq_.index(t);
+  if(idx >= 0)
+  {
+    return Eigen::Vector2d(
+        extZmpDataSeq_.scale(idx) * extZmpDataSeq_.refZmpX(idx) - extZmpDataSeq_.offsetX(idx),
+        extZmpDataSeq_.scale(idx) * extZmpDataSeq_.refZmpY(idx) - extZmpDataSeq_.offsetY(idx));
+  }
+
   Eigen::Vector2d refZmp = CentroidalManagerPreviewControlZmp::calcRefData(t);
   ExtZmpData extZmpData = calcExtZmpData(t);
   // Add hand forces effects
   return extZmpData.apply(refZmp);
 }
 
-CentroidalManagerPreviewControlExtZmp::ExtZmpData CentroidalManagerPreviewControlExtZmp::calcExtZmpData(double t) const
+bool CentroidalManagerPreviewControlExtZmp::runAsyncMpc(Eigen::Index horizonSize)
 {
-  ExtZmpData extZmpData;
-  extZmpData.scale = 0.0;
-  extZmpData.offset.setZero();
+  // Receive the latest result without blocking (the previous one is kept if the worker is swapping the buffers)
+  // The buffers are swapped so that they are reused without reallocation
+  {
+    std::unique_lock<std::mutex> lock(asyncMpcResultMtx_, std::try_to_lock);
+    AsyncMpcResult & latestResult = asyncMpcResults_[asyncMpcResultIdx_];
+    if(lock.owns_lock() && latestResult.valid && (!asyncMpcResult_.valid || asyncMpcResult_.t < latestResult.t))
+    {
+      std::swap(asyncMpcResult_, latestResult);
+      std::swap(extZmpDataSeq_, asyncMpcResult_.extZmpDataSeq);
+    }
+  }
 
-  Eigen::Vector3d refZmp = ctl().footManager_->calcRefZmp(t);
-  for(const auto & hand : Hands::Both)
+  // Send the request without blocking (skipped if the worker is taking the previous one)
   {
-    if(ctl().manipManager_->manipPhase(hand)->label() != ManipPhaseLabel::Hold)
+    std::unique_lock<std::mutex> lock(asyncMpcRequestMtx_, std::try_to_lock);
+    if(lock.owns_lock())
     {
-      continue;
+      asyncMpcRequest_.t = ctl().t();
+      asyncMpcRequest_.dt = ctl().dt();
+      asyncMpcRequest_.horizonDt = config_.horizonDt;
+      asyncMpcRequest_.horizonSize = horizonSize;
+      asyncMpcRequest_.initialParam.pos = mpcCom_.head<2>();
+      asyncMpcRequest_.initialParam.vel = mpcComVel_.head<2>();
+      if(config_.useActualStateForMpc)
+      {
+        asyncMpcRequest_.initialParam.acc.setZero();
+      }
+      else
+      {
+        // Since the actual CoM acceleration cannot be obtained, only the planned one is used
+        asyncMpcRequest_.initialParam.acc = ctl().comTask_->refAccel().head<2>();
+      }
+      copyExtZmpRefData(ctl().t(), ctl().t() + static_cast<double>(horizonSize - 1) * config_.horizonDt,
+                        asyncMpcRequest_.refData);
+      asyncMpcRequested_ = true;
+      lock.unlock();
+      asyncMpcRequestCv_.notify_one();
     }
+  }
+
+  return asyncMpcResult_.valid && ctl().t() - asyncMpcResult_.t <= asyncMpcConfig_.maxStaleDuration;
+}
+
+void CentroidalManagerPreviewControlExtZmp::startAsyncMpcThread()
+{
+  asyncPc_ = std::make_shared<CCC::PreviewControlZmp>(config_.refComZ, config_.horizonDuration, config_.horizonDt);
+
+  asyncMpcRequested_ = false;
+  asyncMpcStopRequested_ = false;
+  asyncMpcResult_ = AsyncMpcResult();
+  for(auto & result : asyncMpcResults_)
+  {
+    result = AsyncMpcResult();
+  }
+  asyncMpcResultIdx_ = 0;
 
-    // Assume that objPoseOffset is constant
-    sva::PTransformd objPose = ctl().manipManager_->objPoseOffset() * ctl().manipManager_->calcRefObjPose(t);
-    sva::PTransformd handPose = ctl().manipManager_->config().objToHandTranss.at(hand) * objPose;
-    // Represent the hand wrench in the frame whose position is same with the hand frame and orientation is same with
-    // the world frame
-    sva::ForceVecd handWrenchLocal = ctl().manipManager_->calcRefHandWrench(hand, t);
-    sva::PTransformd handRotTrans(Eigen::Matrix3d(handPose.rotation()));
-    sva::ForceVecd handWrench = handRotTrans.transMul(handWrenchLocal);
-
-    const auto & pos = handPose.translation();
-    const auto & force = handWrench.force();
-    const auto & moment = handWrench.moment();
-
-    // Equation (3) in the paper:
-    //   M Murooka, et al. Humanoid loco-Manipulations pattern generation and stabilization control. RA-Letters, 2021
-    extZmpData.scale -= force.z();
-    extZmpData.offset.x() += (pos.z() - refZmp.z()) * force.x() - pos.x() * force.z() + moment.y();
-    extZmpData.offset.y() += (pos.z() - refZmp.z()) * force.y() - pos.y() * force.z() - moment.x();
-  }
-
-  // Ignore the effect of CoM Z acceleration
-  double mg = robotMass_ * mc_rtc::constants::gravity.z();
-  extZmpData.scale /= mg;
-  extZmpData.scale += 1.0;
-  extZmpData.offset /= mg;
-
-  return extZmpData;
+  asyncMpcThread_ = std::thread(&CentroidalManagerPreviewControlExtZmp::asyncMpcLoop, this);
+}
+
+void CentroidalManagerPreviewControlExtZmp::stopAsyncMpcThread()
+{
+  if(!asyncMpcThread_.joinable())
+  {
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(asyncMpcRequestMtx_);
+    asyncMpcStopRequested_ = true;
+  }
+  asyncMpcRequestCv_.notify_one();
+  asyncMpcThread_.join();
+}
+
+void CentroidalManagerPreviewControlExtZmp::asyncMpcLoop()
+{
+  AsyncMpcRequest request;
+
+  while(true)
+  {
+    // Take the request by swapping the buffers so that they are reused without reallocation
+    {
+      std::unique_lock<std::mutex> lock(asyncMpcRequestMtx_);
+      asyncMpcRequestCv_.wait(lock, [this]() { return asyncMpcRequested_ || asyncMpcStopRequested_; });
+      if(asyncMpcStopRequested_)
+      {
+        return;
+      }
+      std::swap(request, asyncMpcRequest_);
+      asyncMpcRequested_ = false;
+    }
+
+    // Calculate the reference sequence and solve the preview control into the back buffer
+    // The index of the latest result is modified only in this thread, so it can be read without lock
+    AsyncMpcResult & result = asyncMpcResults_[1 - asyncMpcResultIdx_];
+    ExtZmpDataSeq & extZmpDataSeq = result.extZmpDataSeq;
+    {
+      LMC_TRACE_SCOPE("CentroidalManagerPreviewControlExtZmp::asyncMpcRef");
+      request.refData.manipRefFuncs.build();
+      calcExtZmpDataSeq(request.refData, request.t, request.horizonDt, request.horizonSize, extZmpDataSeq);
+    }
+    Eigen::Index lastIdx = extZmpDataSeq.size() - 1;
+    auto refFunc = [&](double t) -> Eigen::Vector2d {
+      Eigen::Index idx = static_cast<Eigen::Index>(std::round((t - request.t) / request.horizonDt));
+      idx = std::clamp<Eigen::Index>(idx, 0, lastIdx);
+      return Eigen::Vector2d(extZmpDataSeq.scale(idx) * extZmpDataSeq.refZmpX(idx) - extZmpDataSeq.offsetX(idx),
+                             extZmpDataSeq.scale(idx) * extZmpDataSeq.refZmpY(idx) - extZmpDataSeq.offsetY(idx));
+    };
+    {
+      LMC_TRACE_SCOPE("CentroidalManagerPreviewControlExtZmp::asyncMpcPlan");
+      result.plannedExtZmp = asyncPc_->planOnce(refFunc, request.initialParam, request.t, request.dt);
+    }
+    result.t = request.t;
+    result.valid = true;
+
+    // Publish the back buffer as the latest result
+    {
+      std::lock_guard<std::mutex> lock(asyncMpcResultMtx_);
+      asyncMpcResultIdx_ = 1 - asyncMpcResultIdx_;
+    }
+  }
 }
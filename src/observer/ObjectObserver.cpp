@@ -0,0 +1,225 @@
+#include <mc_control/MCController.h>
+#include <mc_observers/ObserverMacros.h>
+#include <mc_rtc/gui/Label.h>
+#include <mc_rtc/ros.h>
+
+#include <LocomanipController/observer/ObjectObserver.h>
+
+using namespace LMC;
+
+void ObjectObserver::Configuration::load(const mc_rtc::Configuration & mcRtcConfig)
+{
+  mcRtcConfig("robot", robot);
+  mcRtcConfig("poseTopic", poseTopic);
+  mcRtcConfig("velTopic", velTopic);
+  mcRtcConfig("linearAccelNoise", linearAccelNoise);
+  mcRtcConfig("angularAccelNoise", angularAccelNoise);
+  mcRtcConfig("linearPosNoise", linearPosNoise);
+  mcRtcConfig("angularPosNoise", angularPosNoise);
+  mcRtcConfig("linearVelNoise", linearVelNoise);
+  mcRtcConfig("angularVelNoise", angularVelNoise);
+}
+
+void ObjectObserver::AxisFilter::reset(double pos, double posVar, double velVar)
+{
+  x << pos, 0.0;
+  P << posVar, 0.0, 0.0, velVar;
+}
+
+void ObjectObserver::AxisFilter::predict(double dt, double accelNoise)
+{
+  // x = F x, P = F P F^T + Q with F = [1 dt; 0 1]
+  x[0] += dt * x[1];
+  double P00 = P(0, 0) + dt * (P(1, 0) + P(0, 1)) + dt * dt * P(1, 1);
+  double P01 = P(0, 1) + dt * P(1, 1);
+  double P11 = P(1, 1);
+  P(0, 0) = P00 + accelNoise * std::pow(dt, 3) / 3.0;
+  P(0, 1) = P01 + accelNoise * std::pow(dt, 2) / 2.0;
+  P(1, 0) = P(0, 1);
+  P(1, 1) = P11 + accelNoise * dt;
+}
+
+void ObjectObserver::AxisFilter::updatePos(double pos, double var)
+{
+  // H = [1 0]
+  double S = P(0, 0) + var;
+  Eigen::Vector2d K = P.col(0) / S;
+  x += K * (pos - x[0]);
+  P -= K * P.row(0);
+}
+
+void ObjectObserver::AxisFilter::updateVel(double vel, double var)
+{
+  // H = [0 1]
+  double S = P(1, 1) + var;
+  Eigen::Vector2d K = P.col(1) / S;
+  x += K * (vel - x[1]);
+  P -= K * P.row(1);
+}
+
+ObjectObserver::ObjectObserver(const std::string & type, double dt) : mc_observers::Observer(type, dt) {}
+
+void ObjectObserver::configure(const mc_control::MCController & ctl, const mc_rtc::Configuration & mcRtcConfig)
+{
+  config_.load(mcRtcConfig);
+
+  if(!ctl.hasRobot(config_.robot))
+  {
+    mc_rtc::log::error_and_throw("[ObjectObserver] The object robot {} does not exist.", config_.robot);
+  }
+
+  desc_ = name_ + " (robot=" + config_.robot + ")";
+}
+
+void ObjectObserver::reset(const mc_control::MCController & ctl)
+{
+  // Setup ROS
+  if(!nh_)
+  {
+    if(!mc_rtc::ROSBridge::get_node_handle())
+    {
+      mc_rtc::log::warning("[ObjectObserver] ROS is not initialized.");
+    }
+    else
+    {
+      nh_ = std::make_unique<ros::NodeHandle>();
+      // Use a dedicated queue so as not to call callbacks of other modules
+      nh_->setCallbackQueue(&callbackQueue_);
+      if(!config_.poseTopic.empty())
+      {
+        poseSub_ = nh_->subscribe<geometry_msgs::PoseStamped>(config_.poseTopic, 1, &ObjectObserver::poseCallback,
+                                                              this);
+      }
+      if(!config_.velTopic.empty())
+      {
+        velSub_ = nh_->subscribe<geometry_msgs::TwistStamped>(config_.velTopic, 1, &ObjectObserver::velCallback, this);
+      }
+    }
+  }
+
+  // Reset the filters with the current pose of the real object
+  resetFilters(ctl.realRobot(config_.robot).posW());
+  initialized_ = false;
+}
+
+bool ObjectObserver::run(const mc_control::MCController &)
+{
+  // Call ROS callback
+  if(nh_)
+  {
+    callbackQueue_.callAvailable(ros::WallDuration());
+  }
+
+  // Predict
+  for(size_t i = 0; i < 3; i++)
+  {
+    filters_[i].predict(dt(), config_.linearAccelNoise);
+    filters_[i + 3].predict(dt(), config_.angularAccelNoise);
+  }
+
+  // Update with pose measurement
+  std::array<double, 7> poseData;
+  if(poseBuffer_.read(poseData))
+  {
+    Eigen::Vector3d measuredPos(poseData[0], poseData[1], poseData[2]);
+    Eigen::Matrix3d measuredRot =
+        Eigen::Quaterniond(poseData[3], poseData[4], poseData[5], poseData[6]).normalized().toRotationMatrix();
+
+    if(!initialized_)
+    {
+      initialized_ = true;
+      resetFilters(sva::PTransformd(measuredRot.transpose(), measuredPos));
+    }
+    else
+    {
+      // Rotation vector from the estimated rotation to the measured rotation in the world frame
+      Eigen::AngleAxisd rotError(measuredRot * rot_.transpose());
+      Eigen::Vector3d rotErrorVec = rotError.angle() * rotError.axis();
+      for(size_t i = 0; i < 3; i++)
+      {
+        filters_[i].updatePos(measuredPos[i], config_.linearPosNoise);
+        filters_[i + 3].updatePos(rotErrorVec[i], config_.angularPosNoise);
+      }
+    }
+  }
+
+  // Update with velocity measurement
+  std::array<double, 6> velData;
+  if(velBuffer_.read(velData))
+  {
+    for(size_t i = 0; i < 3; i++)
+    {
+      filters_[i].updateVel(velData[i + 3], config_.linearVelNoise);
+      filters_[i + 3].updateVel(velData[i], config_.angularVelNoise);
+    }
+  }
+
+  // Apply the rotation vector to the estimated rotation
+  Eigen::Vector3d rotVec(filters_[3].x[0], filters_[4].x[0], filters_[5].x[0]);
+  double rotAngle = rotVec.norm();
+  if(rotAngle > 1e-10)
+  {
+    rot_ = Eigen::AngleAxisd(rotAngle, rotVec / rotAngle).toRotationMatrix() * rot_;
+  }
+  for(size_t i = 3; i < 6; i++)
+  {
+    filters_[i].x[0] = 0.0;
+  }
+
+  pose_ = sva::PTransformd(rot_.transpose(), Eigen::Vector3d(filters_[0].x[0], filters_[1].x[0], filters_[2].x[0]));
+  vel_ = sva::MotionVecd(Eigen::Vector3d(filters_[3].x[1], filters_[4].x[1], filters_[5].x[1]),
+                         Eigen::Vector3d(filters_[0].x[1], filters_[1].x[1], filters_[2].x[1]));
+
+  return true;
+}
+
+void ObjectObserver::update(mc_control::MCController & ctl)
+{
+  auto & realObj = ctl.realRobot(config_.robot);
+  realObj.posW(pose_);
+  realObj.velW(vel_);
+}
+
+void ObjectObserver::addToLogger(const mc_control::MCController &,
+                                 mc_rtc::Logger & logger,
+                                 const std::string & category)
+{
+  logger.addLogEntry(category + "_pose", this, [this]() { return pose_; });
+  logger.addLogEntry(category + "_vel", this, [this]() { return vel_; });
+}
+
+void ObjectObserver::addToGUI(const mc_control::MCController &,
+                              mc_rtc::gui::StateBuilder & gui,
+                              const std::vector<std::string> & category)
+{
+  gui.addElement(category, mc_rtc::gui::Label("initialized",
+                                               [this]() { return std::string(initialized_ ? "Yes" : "No"); }));
+}
+
+void ObjectObserver::resetFilters(const sva::PTransformd & pose)
+{
+  rot_ = pose.rotation().transpose();
+  for(size_t i = 0; i < 3; i++)
+  {
+    filters_[i].reset(pose.translation()[i], config_.linearPosNoise, 1.0);
+    filters_[i + 3].reset(0.0, config_.angularPosNoise, 1.0);
+  }
+  pose_ = pose;
+  vel_ = sva::MotionVecd::Zero();
+}
+
+void ObjectObserver::poseCallback(const geometry_msgs::PoseStamped::ConstPtr & poseStMsg)
+{
+  const auto & poseMsg = poseStMsg->pose;
+  poseBuffer_.write({poseMsg.position.x, poseMsg.position.y, poseMsg.position.z, poseMsg.orientation.w,
+                     poseMsg.orientation.x, poseMsg.orientation.y, poseMsg.orientation.z});
+}
+
+void ObjectObserver::velCallback(const geometry_msgs::TwistStamped::ConstPtr & twistStMsg)
+{
+  const auto & twistMsg = twistStMsg->twist;
+  velBuffer_.write({twistMsg.angular.x, twistMsg.angular.y, twistMsg.angular.z, twistMsg.linear.x, twistMsg.linear.y,
+                    twistMsg.linear.z});
+}
+
+EXPORT_OBSERVER_MODULE("LMC::Object", LMC::ObjectObserver)
@@ -3,6 +3,7 @@
 #include <LocomanipController/ManipManager.h>
 #include <LocomanipController/ManipPhase.h>
 #include <LocomanipController/MathUtils.h>
+#include <LocomanipController/TraceRecorder.h>
 #include <LocomanipController/states/ConfigManipState.h>
 
 using namespace LMC;
@@ -12,12 +13,15 @@ void ConfigManipState::start(mc_control::fsm::Controller & _ctl)
   State::start(_ctl);
 
   phase_ = 0;
+  waitFootstepPlan_ = false;
 
   output("OK");
 }
 
 bool ConfigManipState::run(mc_control::fsm::Controller &)
 {
+  LMC_TRACE_SCOPE("ConfigManipState::run");
+
   if(phase_ == 0)
   {
     if(config_.has("configs") && config_("configs")("preUpdateObj", false))
@@ -68,8 +72,8 @@ bool ConfigManipState::run(mc_control::fsm::Controller &)
   }
   else if(phase_ == 4)
   {
-    bool isReached = (ctl().manipManager_->manipPhase(Hand::Left)->label() == ManipPhaseLabel::Hold
-                      || ctl().manipManager_->manipPhase(Hand::Right)->label() == ManipPhaseLabel::Hold);
+    bool isReached = (ctl().manipManager_->manipPhase(Hand::Left).label() == ManipPhaseLabel::Hold
+                      || ctl().manipManager_->manipPhase(Hand::Right).label() == ManipPhaseLabel::Hold);
     if(config_.has("configs") && config_("configs")("reach", !isReached))
     {
       ctl().manipManager_->reachHandToObj();
@@ -82,8 +86,8 @@ bool ConfigManipState::run(mc_control::fsm::Controller &)
   }
   else if(phase_ == 5)
   {
-    if(ctl().manipManager_->manipPhase(Hand::Left)->label() == ManipPhaseLabel::Hold
-       && ctl().manipManager_->manipPhase(Hand::Right)->label() == ManipPhaseLabel::Hold)
+    if(ctl().manipManager_->manipPhase(Hand::Left).label() == ManipPhaseLabel::Hold
+       && ctl().manipManager_->manipPhase(Hand::Right).label() == ManipPhaseLabel::Hold)
     {
       phase_ = 6;
     }
@@ -133,7 +137,16 @@ bool ConfigManipState::run(mc_control::fsm::Controller &)
   }
   else if(phase_ == 10)
   {
-    if(config_.has("configs") && config_("configs").has("waypointList"))
+    if(waitFootstepPlan_)
+    {
+      // Wait for the footsteps planned in the background thread to be appended to the footstep queue
+      if(!ctl().manipManager_->planningFootstep())
+      {
+        waitFootstepPlan_ = false;
+        phase_ = 11;
+      }
+    }
+    else if(config_.has("configs") && config_("configs").has("waypointList"))
     {
       double startTime = ctl().t();
       sva::PTransformd pose = ctl().manipManager_->calcRefObjPose(ctl().t());
@@ -170,9 +183,12 @@ bool ConfigManipState::run(mc_control::fsm::Controller &)
       if(config_("configs")("footstep", true))
       {
         ctl().manipManager_->requireFootstepFollowingObj();
+        waitFootstepPlan_ = true;
+      }
+      else
+      {
+        phase_ = 11;
       }
-
-      phase_ = 11;
     }
     else if(config_.has("configs") && config_("configs").has("velocityMode"))
     {
@@ -202,7 +218,7 @@ bool ConfigManipState::run(mc_control::fsm::Controller &)
     }
 
     if(ctl().manipManager_->waypointQueue().empty() && ctl().footManager_->footstepQueue().empty()
-       && !ctl().manipManager_->velModeEnabled())
+       && !ctl().manipManager_->generatingFootstep() && !ctl().manipManager_->velModeEnabled())
     {
       phase_ = 12;
     }
@@ -264,8 +280,8 @@ bool ConfigManipState::run(mc_control::fsm::Controller &)
   }
   else if(phase_ == 17)
   {
-    if(ctl().manipManager_->manipPhase(Hand::Left)->label() == ManipPhaseLabel::Free
-       && ctl().manipManager_->manipPhase(Hand::Right)->label() == ManipPhaseLabel::Free)
+    if(ctl().manipManager_->manipPhase(Hand::Left).label() == ManipPhaseLabel::Free
+       && ctl().manipManager_->manipPhase(Hand::Right).label() == ManipPhaseLabel::Free)
     {
       phase_ = 18;
     }
@@ -7,6 +7,7 @@
 #include <LocomanipController/ManipManager.h>
 #include <LocomanipController/ManipPhase.h>
 #include <LocomanipController/MathUtils.h>
+#include <LocomanipController/TraceRecorder.h>
 #include <LocomanipController/states/GuiManipState.h>
 
 using namespace LMC;
@@ -53,13 +54,13 @@ void GuiManipState::start(mc_control::fsm::Controller & _ctl)
       mc_rtc::gui::Form(
           "MoveObj",
           [this](const mc_rtc::Configuration & config) {
-            if(!(ctl().manipManager_->manipPhase(Hand::Left)->label() == ManipPhaseLabel::Hold
-                 || ctl().manipManager_->manipPhase(Hand::Right)->label() == ManipPhaseLabel::Hold))
+            if(!(ctl().manipManager_->manipPhase(Hand::Left).label() == ManipPhaseLabel::Hold
+                 || ctl().manipManager_->manipPhase(Hand::Right).label() == ManipPhaseLabel::Hold))
             {
               mc_rtc::log::error("[GuiManipState] \"MoveObj\" command is available only when the manipulation "
                                  "phase is Hold. Left: {}, Right: {}",
-                                 std::to_string(ctl().manipManager_->manipPhase(Hand::Left)->label()),
-                                 std::to_string(ctl().manipManager_->manipPhase(Hand::Right)->label()));
+                                 std::to_string(ctl().manipManager_->manipPhase(Hand::Left).label()),
+                                 std::to_string(ctl().manipManager_->manipPhase(Hand::Right).label()));
               return;
             }
             if(!ctl().manipManager_->waypointQueue().empty())
@@ -149,6 +150,8 @@ void GuiManipState::start(mc_control::fsm::Controller & _ctl)
 
 bool GuiManipState::run(mc_control::fsm::Controller &)
 {
+  LMC_TRACE_SCOPE("GuiManipState::run");
+
   return false;
 }
 
@@ -7,6 +7,8 @@
 #include <BaselineWalkingController/FootManager.h>
 #include <LocomanipController/LocomanipController.h>
 #include <LocomanipController/ManipManager.h>
+#include <LocomanipController/PlanPublisher.h>
+#include <LocomanipController/TraceRecorder.h>
 #include <LocomanipController/states/InitialState.h>
 
 using namespace LMC;
@@ -25,6 +27,8 @@ void InitialState::start(mc_control::fsm::Controller & _ctl)
 
 bool InitialState::run(mc_control::fsm::Controller &)
 {
+  LMC_TRACE_SCOPE("InitialState::run");
+
   if(phase_ == 0)
   {
     // Auto start
@@ -67,6 +71,10 @@ bool InitialState::run(mc_control::fsm::Controller &)
     ctl().manipManager_->reset();
     ctl().footManager_->reset();
     ctl().centroidalManager_->reset();
+    if(ctl().planPublisher_)
+    {
+      ctl().planPublisher_->reset();
+    }
     ctl().enableManagerUpdate_ = true;
 
     // Setup anchor frame
@@ -3,6 +3,7 @@
 
 #include <LocomanipController/LocomanipController.h>
 #include <LocomanipController/ManipManager.h>
+#include <LocomanipController/TraceRecorder.h>
 #include <LocomanipController/states/TeleopState.h>
 
 using namespace LMC;
@@ -21,6 +22,8 @@ void TeleopState::start(mc_control::fsm::Controller & _ctl)
 
   // Load configuration
   std::string twistTopicName = "/cmd_vel";
+  std::string velProfileTopicName;
+  bool useAsyncSpinner = false;
   if(config_.has("configs"))
   {
     if(config_("configs").has("velScale"))
@@ -29,6 +32,8 @@ void TeleopState::start(mc_control::fsm::Controller & _ctl)
       velScale_[2] = mc_rtc::constants::toRad(velScale_[2]);
     }
     config_("configs")("twistTopicName", twistTopicName);
+    config_("configs")("velProfileTopicName", velProfileTopicName);
+    config_("configs")("useAsyncSpinner", useAsyncSpinner);
   }
 
   // Setup ROS
@@ -36,6 +41,17 @@ void TeleopState::start(mc_control::fsm::Controller & _ctl)
   // Use a dedicated queue so as not to call callbacks of other modules
   nh_->setCallbackQueue(&callbackQueue_);
   twistSub_ = nh_->subscribe<geometry_msgs::Twist>(twistTopicName, 1, &TeleopState::twistCallback, this);
+  if(!velProfileTopicName.empty())
+  {
+    velProfileSub_ = nh_->subscribe<trajectory_msgs::MultiDOFJointTrajectory>(
+        velProfileTopicName, 1, &TeleopState::velProfileCallback, this);
+  }
+  useVelProfile_ = false;
+  if(useAsyncSpinner)
+  {
+    spinner_ = std::make_unique<ros::AsyncSpinner>(1, &callbackQueue_);
+    spinner_->start();
+  }
 
   // Setup GUI
   ctl().gui()->addElement({ctl().name(), "Teleop"},
@@ -49,6 +65,7 @@ void TeleopState::start(mc_control::fsm::Controller & _ctl)
                               },
                               [this](const Eigen::Vector3d & v) {
                                 targetVel_ = Eigen::Vector3d(v[0], v[1], mc_rtc::constants::toRad(v[2]));
+                                useVelProfile_ = false;
                               }));
 
   output("OK");
@@ -56,6 +73,8 @@ void TeleopState::start(mc_control::fsm::Controller & _ctl)
 
 bool TeleopState::run(mc_control::fsm::Controller &)
 {
+  LMC_TRACE_SCOPE("TeleopState::run");
+
   // Finish if ROS is not initialized
   if(!mc_rtc::ROSBridge::get_node_handle())
   {
@@ -63,7 +82,31 @@ bool TeleopState::run(mc_control::fsm::Controller &)
   }
 
   // Call ROS callback
-  callbackQueue_.callAvailable(ros::WallDuration());
+  if(!spinner_)
+  {
+    callbackQueue_.callAvailable(ros::WallDuration());
+  }
+  std::array<double, 3> twist;
+  if(twistBuffer_.read(twist))
+  {
+    targetVel_ = velScale_.cwiseProduct(Eigen::Vector3d(twist[0], twist[1], twist[2]));
+    useVelProfile_ = false;
+  }
+  if(velProfileBuffer_.read(velProfile_))
+  {
+    // Convert ROS times to controller times
+    double timeOffset = ctl().t() - ros::Time::now().toSec();
+    for(size_t i = 0; i < velProfile_.pointNum; i++)
+    {
+      velProfile_.times[i] += timeOffset;
+      for(size_t j = 0; j < 3; j++)
+      {
+        velProfile_.vels[i][j] *= velScale_[j];
+      }
+    }
+    useVelProfile_ = true;
+    requireVelProfileUpdate_ = true;
+  }
 
   // Update GUI
   bool velMode = ctl().manipManager_->velModeEnabled();
@@ -83,7 +126,25 @@ bool TeleopState::run(mc_control::fsm::Controller &)
   // Set target velocity
   if(ctl().manipManager_->velModeEnabled())
   {
-    ctl().manipManager_->setRelativeVel(targetVel_);
+    if(useVelProfile_)
+    {
+      // The profile is set only when it is received because it is validated and planned ahead in ManipManager
+      // If the profile is invalid, ManipManager keeps the current command
+      if(requireVelProfileUpdate_)
+      {
+        ctl().manipManager_->setRelativeVelProfile(velProfile_);
+        requireVelProfileUpdate_ = false;
+      }
+    }
+    else
+    {
+      ctl().manipManager_->setRelativeVel(targetVel_);
+    }
+  }
+  else
+  {
+    // Set the profile again when the velocity mode is restarted
+    requireVelProfileUpdate_ = true;
   }
 
   return false;
@@ -91,13 +152,47 @@ bool TeleopState::run(mc_control::fsm::Controller &)
 
 void TeleopState::teardown(mc_control::fsm::Controller &)
 {
+  // Clean up ROS
+  if(spinner_)
+  {
+    spinner_->stop();
+    spinner_.reset();
+  }
+  twistSub_.shutdown();
+  velProfileSub_.shutdown();
+
   // Clean up GUI
   ctl().gui()->removeCategory({ctl().name(), "Teleop"});
 }
 
 void TeleopState::twistCallback(const geometry_msgs::Twist::ConstPtr & twistMsg)
 {
-  targetVel_ = velScale_.cwiseProduct(Eigen::Vector3d(twistMsg->linear.x, twistMsg->linear.y, twistMsg->angular.z));
+  // Store twist, which is converted to the target velocity in run
+  twistBuffer_.write({twistMsg->linear.x, twistMsg->linear.y, twistMsg->angular.z});
+}
+
+void TeleopState::velProfileCallback(const trajectory_msgs::MultiDOFJointTrajectory::ConstPtr & trajMsg)
+{
+  // Store velocity profile, which is converted to the controller time in run
+  ManipManager::VelProfile velProfile;
+  // Use the reception time if the stamp is not set
+  double stamp = trajMsg->header.stamp.isZero() ? ros::Time::now().toSec() : trajMsg->header.stamp.toSec();
+  for(const auto & point : trajMsg->points)
+  {
+    if(velProfile.pointNum == ManipManager::VelProfile::maxPointNum)
+    {
+      break;
+    }
+    if(point.velocities.empty())
+    {
+      continue;
+    }
+    const auto & twistMsg = point.velocities[0];
+    velProfile.times[velProfile.pointNum] = stamp + point.time_from_start.toSec();
+    velProfile.vels[velProfile.pointNum] = {twistMsg.linear.x, twistMsg.linear.y, twistMsg.angular.z};
+    velProfile.pointNum++;
+  }
+  velProfileBuffer_.write(velProfile);
 }
 
 EXPORT_SINGLE_STATE("LMC::Teleop", TeleopState)
@@ -0,0 +1,377 @@
+#include <functional>
+
+#include <benchmark/benchmark.h>
+
+#include <mc_rbdyn/RobotLoader.h>
+
+#include <ros/ros.h>
+
+#include <BaselineWalkingController/FootManager.h>
+#include <LocomanipController/LocomanipController.h>
+#include <LocomanipController/ManipManager.h>
+#include <LocomanipController/centroidal/CentroidalManagerPreviewControlExtZmp.h>
+
+using namespace LMC;
+
+namespace
+{
+//! Control timestep [sec]
+constexpr double dt = 0.005;
+
+//! Duration after which the controller time is rewound and the benchmark state is restored [sec]
+constexpr double rewindInterval = 1.0;
+
+//! Object pose interpolators selected by the benchmark argument
+const std::vector<std::string> objPoseInterpolators = {"BangBang", "Cubic"};
+
+/** \brief Controller whose time can be set by the benchmarks. */
+class LocomanipControllerBench : public LocomanipController
+{
+public:
+  using LocomanipController::LocomanipController;
+
+  /** \brief Set the current time.
+      \param t time [sec]
+  */
+  void setTime(double t)
+  {
+    t_ = t;
+  }
+};
+
+/** \brief Manipulation manager exposing the sub-steps of update. */
+class ManipManagerBench : public ManipManager
+{
+public:
+  using ManipManager::ManipManager;
+
+  using ManipManager::updateFootstep;
+  using ManipManager::updateForVelMode;
+  using ManipManager::updateHandTraj;
+  using ManipManager::updateObjTraj;
+
+  /** \brief Set the manipulation phases of both hands to Hold without reaching. */
+  void holdBothHands()
+  {
+    for(const auto & hand : Hands::Both)
+    {
+      manipPhases_.at(hand).start(ManipPhaseLabel::Hold);
+    }
+  }
+};
+
+/** \brief Centroidal manager exposing the MPC and the ext-ZMP calculation. */
+class CentroidalManagerBench : public CentroidalManagerPreviewControlExtZmp
+{
+public:
+  CentroidalManagerBench(LocomanipController * ctlPtr, const mc_rtc::Configuration & mcRtcConfig)
+  : BWC::CentroidalManager(ctlPtr, mcRtcConfig), CentroidalManagerPreviewControlExtZmp(ctlPtr, mcRtcConfig)
+  {
+  }
+
+  using CentroidalManagerPreviewControlExtZmp::calcExtZmpData;
+  using CentroidalManagerPreviewControlExtZmp::runMpc;
+};
+
+/** \brief Get the controller shared by all the benchmarks.
+
+    The FSM is not started; the managers are reset and updated directly by the benchmarks.
+*/
+LocomanipControllerBench & controller()
+{
+  static std::unique_ptr<LocomanipControllerBench> ctl = []() {
+    mc_rbdyn::RobotLoader::load_aliases(LMC_ALIASES_PATH);
+    auto rm = mc_rbdyn::RobotLoader::get_robot_module("JVRC1");
+    auto ctl = std::make_unique<LocomanipControllerBench>(rm, dt, mc_rtc::Configuration(LMC_CONFIG_PATH));
+    ctl->mc_control::MCController::reset({ctl->robot().mbc().q});
+    ctl->footManager_->reset();
+    return ctl;
+  }();
+  return *ctl;
+}
+
+/** \brief Time stepper advancing the controller time by one control cycle in each benchmark iteration.
+
+    The controller time is rewound to the start time every rewindInterval so that the waypoints are not exhausted and
+    the workload stays comparable between iterations. The time is also rewound when the stepper is destructed.
+*/
+class TimeStepper
+{
+public:
+  /** \brief Constructor.
+      \param state benchmark state
+      \param restoreFunc function to restore the benchmark state after the time is rewound
+  */
+  TimeStepper(benchmark::State & state, std::function<void()> restoreFunc)
+  : state_(state), restoreFunc_(restoreFunc), startTime_(controller().t())
+  {
+  }
+
+  /** \brief Destructor. */
+  ~TimeStepper()
+  {
+    controller().setTime(startTime_);
+  }
+
+  /** \brief Advance the controller time by one control cycle. */
+  void step()
+  {
+    auto & ctl = controller();
+    ctl.setTime(ctl.t() + dt);
+    if(ctl.t() - startTime_ >= rewindInterval)
+    {
+      state_.PauseTiming();
+      ctl.setTime(startTime_);
+      restoreFunc_();
+      state_.ResumeTiming();
+    }
+  }
+
+protected:
+  //! Benchmark state
+  benchmark::State & state_;
+
+  //! Function to restore the benchmark state after the time is rewound
+  std::function<void()> restoreFunc_;
+
+  //! Start time [sec]
+  double startTime_;
+};
+
+/** \brief Make a manipulation manager and set it to the controller.
+    \param objPoseInterpolatorIdx index of objPoseInterpolators
+    \param objHorizon horizon of object trajectory [sec]
+*/
+std::shared_ptr<ManipManagerBench> makeManipManager(int64_t objPoseInterpolatorIdx, double objHorizon)
+{
+  auto & ctl = controller();
+
+  // Copy the configuration so as not to modify the controller configuration
+  mc_rtc::Configuration mcRtcConfig;
+  mcRtcConfig.load(ctl.config()("ManipManager"));
+  mcRtcConfig.add("objPoseInterpolator", objPoseInterpolators.at(objPoseInterpolatorIdx));
+  mcRtcConfig.add("objHorizon", objHorizon);
+  mcRtcConfig.add("objPoseTopic", std::string(""));
+  mcRtcConfig.add("objVelTopic", std::string(""));
+
+  auto manipManager = std::make_shared<ManipManagerBench>(&ctl, mcRtcConfig);
+  ctl.manipManager_ = manipManager;
+  ctl.footManager_->clearFootstepQueue();
+  manipManager->reset();
+
+  return manipManager;
+}
+
+/** \brief Make a centroidal manager and set it to the controller.
+    \param horizonDuration horizon duration of MPC [sec]
+*/
+std::shared_ptr<CentroidalManagerBench> makeCentroidalManager(double horizonDuration)
+{
+  auto & ctl = controller();
+
+  mc_rtc::Configuration mcRtcConfig;
+  mcRtcConfig.load(ctl.config()("CentroidalManager"));
+  mcRtcConfig.add("horizonDuration", horizonDuration);
+
+  auto centroidalManager = std::make_shared<CentroidalManagerBench>(&ctl, mcRtcConfig);
+  ctl.centroidalManager_ = centroidalManager;
+  centroidalManager->reset();
+
+  return centroidalManager;
+}
+
+/** \brief Append waypoints moving the object forward.
+    \param manipManager manipulation manager
+    \param waypointNum number of waypoints
+*/
+void appendWaypoints(ManipManager & manipManager, int64_t waypointNum)
+{
+  const auto & ctl = controller();
+  sva::PTransformd pose = manipManager.refSnapshot().objPoseWithoutOffset;
+  for(int64_t i = 0; i < waypointNum; i++)
+  {
+    pose = sva::PTransformd(Eigen::Vector3d(0.1, 0.0, 0.0)) * pose;
+    manipManager.appendWaypoint(Waypoint(ctl.t() + i, ctl.t() + i + 1.0, pose));
+  }
+}
+} // namespace
+
+// Arguments: waypoint queue size, object horizon [sec], index of objPoseInterpolators
+static void BM_ManipManager_update(benchmark::State & state)
+{
+  std::shared_ptr<ManipManagerBench> manipManager;
+  auto setup = [&]() {
+    manipManager = makeManipManager(state.range(2), static_cast<double>(state.range(1)));
+    appendWaypoints(*manipManager, state.range(0));
+  };
+  setup();
+  TimeStepper timeStepper(state, setup);
+
+  for(auto _ : state)
+  {
+    timeStepper.step();
+    manipManager->update();
+  }
+}
+BENCHMARK(BM_ManipManager_update)
+    ->ArgsProduct({{10, 100, 1000, 10000}, {1, 3}, {0, 1}})
+    ->Unit(benchmark::kMicrosecond);
+
+static void BM_ManipManager_updateObjTraj(benchmark::State & state)
+{
+  std::shared_ptr<ManipManagerBench> manipManager;
+  auto setup = [&]() {
+    manipManager = makeManipManager(state.range(2), static_cast<double>(state.range(1)));
+    appendWaypoints(*manipManager, state.range(0));
+  };
+  setup();
+  TimeStepper timeStepper(state, setup);
+
+  for(auto _ : state)
+  {
+    timeStepper.step();
+    manipManager->updateObjTraj();
+  }
+}
+BENCHMARK(BM_ManipManager_updateObjTraj)
+    ->ArgsProduct({{10, 100, 1000, 10000}, {1, 3}, {0, 1}})
+    ->Unit(benchmark::kMicrosecond);
+
+static void BM_ManipManager_updateHandTraj(benchmark::State & state)
+{
+  std::shared_ptr<ManipManagerBench> manipManager;
+  auto setup = [&]() {
+    manipManager = makeManipManager(state.range(2), static_cast<double>(state.range(1)));
+    appendWaypoints(*manipManager, state.range(0));
+    manipManager->holdBothHands();
+  };
+  setup();
+  TimeStepper timeStepper(state, setup);
+
+  for(auto _ : state)
+  {
+    timeStepper.step();
+    manipManager->updateHandTraj();
+  }
+}
+BENCHMARK(BM_ManipManager_updateHandTraj)
+    ->ArgsProduct({{10, 10000}, {1, 3}, {0, 1}})
+    ->Unit(benchmark::kMicrosecond);
+
+static void BM_ManipManager_updateFootstep(benchmark::State & state)
+{
+  std::shared_ptr<ManipManagerBench> manipManager;
+  auto setup = [&]() {
+    manipManager = makeManipManager(state.range(2), static_cast<double>(state.range(1)));
+    appendWaypoints(*manipManager, state.range(0));
+  };
+  setup();
+  TimeStepper timeStepper(state, setup);
+
+  for(auto _ : state)
+  {
+    timeStepper.step();
+    manipManager->requireFootstepFollowingObj();
+    manipManager->updateFootstep();
+
+    state.PauseTiming();
+    controller().footManager_->clearFootstepQueue();
+    state.ResumeTiming();
+  }
+}
+BENCHMARK(BM_ManipManager_updateFootstep)
+    ->ArgsProduct({{10, 100, 1000}, {1, 3}, {0, 1}})
+    ->Unit(benchmark::kMillisecond);
+
+// Arguments: object horizon [sec], index of objPoseInterpolators
+static void BM_ManipManager_updateForVelMode(benchmark::State & state)
+{
+  auto & ctl = controller();
+  std::shared_ptr<ManipManagerBench> manipManager;
+  auto teardown = [&]() {
+    manipManager->endVelMode();
+    ctl.footManager_->update();
+    ctl.footManager_->reset();
+  };
+  auto setup = [&]() {
+    manipManager = makeManipManager(state.range(1), static_cast<double>(state.range(0)));
+    manipManager->holdBothHands();
+    if(!manipManager->startVelMode())
+    {
+      return false;
+    }
+    manipManager->setRelativeVel(Eigen::Vector3d(0.2, 0.0, 0.0));
+    ctl.footManager_->update();
+    return true;
+  };
+  if(!setup())
+  {
+    state.SkipWithError("Failed to start velocity mode.");
+    return;
+  }
+  TimeStepper timeStepper(state, [&]() {
+    teardown();
+    setup();
+  });
+
+  for(auto _ : state)
+  {
+    timeStepper.step();
+    manipManager->updateForVelMode();
+  }
+
+  teardown();
+}
+BENCHMARK(BM_ManipManager_updateForVelMode)->ArgsProduct({{1, 3}, {0, 1}})->Unit(benchmark::kMicrosecond);
+
+// Arguments: MPC horizon duration [x 0.1 sec]
+static void BM_CentroidalManagerPreviewControlExtZmp_runMpc(benchmark::State & state)
+{
+  auto manipManager = makeManipManager(0, 3.0);
+  appendWaypoints(*manipManager, 100);
+  manipManager->holdBothHands();
+  manipManager->update();
+  auto centroidalManager = makeCentroidalManager(0.1 * static_cast<double>(state.range(0)));
+  TimeStepper timeStepper(state, []() {});
+
+  for(auto _ : state)
+  {
+    timeStepper.step();
+    centroidalManager->runMpc();
+  }
+}
+BENCHMARK(BM_CentroidalManagerPreviewControlExtZmp_runMpc)->Arg(10)->Arg(20)->Arg(40)->Unit(benchmark::kMicrosecond);
+
+static void BM_CentroidalManagerPreviewControlExtZmp_calcExtZmpData(benchmark::State & state)
+{
+  const auto & ctl = controller();
+  auto manipManager = makeManipManager(0, 3.0);
+  appendWaypoints(*manipManager, 100);
+  manipManager->holdBothHands();
+  manipManager->update();
+  auto centroidalManager = makeCentroidalManager(2.0);
+
+  // Time different from the reference snapshot so as to measure the calculation for a preview sample
+  double t = ctl.t() + 0.1;
+  for(auto _ : state)
+  {
+    benchmark::DoNotOptimize(centroidalManager->calcExtZmpData(t));
+    t += dt;
+    if(t >= ctl.t() + rewindInterval)
+    {
+      t = ctl.t() + 0.1;
+    }
+  }
+}
+BENCHMARK(BM_CentroidalManagerPreviewControlExtZmp_calcExtZmpData)->Unit(benchmark::kNanosecond);
+
+int main(int argc, char ** argv)
+{
+  // ManipManager creates a ROS node handle
+  ros::init(argc, argv, "bench_locomanip_controller", ros::init_options::NoSigintHandler);
+
+  benchmark::Initialize(&argc, argv);
+  benchmark::RunSpecifiedBenchmarks();
+
+  return 0;
+}
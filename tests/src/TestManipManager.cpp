@@ -0,0 +1,344 @@
+#include <algorithm>
+
+#include <gtest/gtest.h>
+
+#include <mc_rbdyn/RobotLoader.h>
+
+#include <ros/ros.h>
+
+#include <BaselineWalkingController/FootManager.h>
+#include <LocomanipController/LocomanipController.h>
+#include <LocomanipController/ManipManager.h>
+
+using namespace LMC;
+
+namespace
+{
+//! Control timestep [sec]
+constexpr double dt = 0.005;
+
+/** \brief Manipulation manager exposing the internal states for the tests. */
+class ManipManagerTest : public ManipManager
+{
+public:
+  using ManipManager::ManipManager;
+
+  using ManipManager::updateRealObj;
+
+  using ManipManager::markerState;
+
+  using ManipManager::initFootstepGenState;
+
+  /** \brief Start the manipulation phase of both hands.
+      \param label manipulation phase label
+  */
+  void startManipPhase(const ManipPhaseLabel & label)
+  {
+    for(const auto & hand : Hands::Both)
+    {
+      manipPhases_.at(hand).start(label);
+    }
+  }
+
+  /** \brief Get the number of knots of the object pose function. */
+  size_t objPoseKnotNum() const
+  {
+    return objPoseFunc_->points().size();
+  }
+
+  /** \brief Get the number of knots of the object pose function for footstep generation. */
+  size_t footstepObjPoseKnotNum() const
+  {
+    return footstepObjPoseFunc_->points().size();
+  }
+
+  /** \brief Get the number of waypoints visited in the last update. */
+  size_t waypointVisitNum() const
+  {
+    return waypointVisitNum_;
+  }
+
+  /** \brief Write an object pose as if it is received from the ROS topic.
+      \param stamp time stamp [sec]
+      \param position object position
+  */
+  void writeObjPose(double stamp, const Eigen::Vector3d & position)
+  {
+    ObjPoseMsgData objPoseMsgData;
+    objPoseMsgData.stamp = stamp;
+    objPoseMsgData.position = {position.x(), position.y(), position.z()};
+    objPoseBuffer_.write(objPoseMsgData);
+  }
+};
+
+/** \brief Controller whose time can be set by the tests. */
+class LocomanipControllerTest : public LocomanipController
+{
+public:
+  using LocomanipController::LocomanipController;
+
+  /** \brief Set the current time.
+      \param t time [sec]
+  */
+  void setTime(double t)
+  {
+    t_ = t;
+  }
+};
+
+/** \brief Get the controller shared by all the tests.
+
+    The FSM is not started; the managers are reset and updated directly by the tests.
+*/
+LocomanipControllerTest & controller()
+{
+  static std::unique_ptr<LocomanipControllerTest> ctl = []() {
+    mc_rbdyn::RobotLoader::load_aliases(LMC_ALIASES_PATH);
+    auto rm = mc_rbdyn::RobotLoader::get_robot_module("JVRC1");
+    auto ctl = std::make_unique<LocomanipControllerTest>(rm, dt, mc_rtc::Configuration(LMC_CONFIG_PATH));
+    ctl->mc_control::MCController::reset({ctl->robot().mbc().q});
+    ctl->footManager_->reset();
+    return ctl;
+  }();
+  return *ctl;
+}
+
+/** \brief Make a manipulation manager and set it to the controller.
+    \param mcRtcConfigOverride configuration overriding that of the controller
+*/
+std::shared_ptr<ManipManagerTest> makeManipManager(const mc_rtc::Configuration & mcRtcConfigOverride = {})
+{
+  auto & ctl = controller();
+
+  // Copy the configuration so as not to modify the controller configuration
+  mc_rtc::Configuration mcRtcConfig;
+  mcRtcConfig.load(ctl.config()("ManipManager"));
+  mcRtcConfig.add("objPoseTopic", std::string(""));
+  mcRtcConfig.add("objVelTopic", std::string(""));
+  mcRtcConfig.load(mcRtcConfigOverride);
+
+  auto manipManager = std::make_shared<ManipManagerTest>(&ctl, mcRtcConfig);
+  ctl.manipManager_ = manipManager;
+  ctl.footManager_->clearFootstepQueue();
+  manipManager->reset();
+
+  return manipManager;
+}
+
+/** \brief Append waypoints moving the object forward by 0.1 m per second.
+    \param manipManager manipulation manager
+    \param waypointNum number of waypoints
+*/
+void appendWaypoints(ManipManager & manipManager, int waypointNum)
+{
+  const auto & ctl = controller();
+  sva::PTransformd pose = manipManager.refSnapshot().objPoseWithoutOffset;
+  for(int i = 0; i < waypointNum; i++)
+  {
+    pose = sva::PTransformd(Eigen::Vector3d(0.1, 0.0, 0.0)) * pose;
+    manipManager.appendWaypoint(Waypoint(ctl.t() + i, ctl.t() + i + 1.0, pose));
+  }
+}
+} // namespace
+
+TEST(TestManipManager, BoundedObjTrajWork)
+{
+  auto & ctl = controller();
+  double startTime = ctl.t();
+  double objHorizon = 2.0;
+  int maxWaypointMarkerNum = 20;
+
+  // Run the update over advancing time and record the maximum numbers of the object pose knots and waypoint markers
+  auto runUpdate = [&](int waypointNum, size_t & maxKnotNum, size_t & maxMarkerNum) {
+    mc_rtc::Configuration mcRtcConfigOverride;
+    mcRtcConfigOverride.add("objHorizon", objHorizon);
+    mcRtcConfigOverride.add("maxWaypointMarkerNum", maxWaypointMarkerNum);
+    mcRtcConfigOverride.add("markerUpdateDecimation", 1);
+    ctl.setTime(startTime);
+    auto manipManager = makeManipManager(mcRtcConfigOverride);
+    appendWaypoints(*manipManager, waypointNum);
+
+    maxKnotNum = 0;
+    maxMarkerNum = 0;
+    for(int i = 0; i < static_cast<int>(5.0 / dt); i++)
+    {
+      ctl.setTime(ctl.t() + dt);
+      manipManager->update();
+      maxKnotNum = std::max(maxKnotNum, manipManager->objPoseKnotNum());
+      maxMarkerNum = std::max(maxMarkerNum, manipManager->markerState().waypointPoses.size());
+    }
+    ctl.setTime(startTime);
+  };
+
+  size_t maxKnotNumShort, maxMarkerNumShort;
+  runUpdate(10, maxKnotNumShort, maxMarkerNumShort);
+  size_t maxKnotNumLong, maxMarkerNumLong;
+  runUpdate(10000, maxKnotNumLong, maxMarkerNumLong);
+
+  // The waypoints within the horizon are same, so the object pose function must not depend on the queue length
+  EXPECT_EQ(maxKnotNumLong, maxKnotNumShort);
+  // Each waypoint of 1 sec adds at most two knots (its start and end), and the first one and the one ending after the
+  // horizon are included
+  EXPECT_LE(maxKnotNumLong, 2 * (static_cast<size_t>(objHorizon) + 2));
+
+  // The current object pose and the waypoints up to maxWaypointMarkerNum are visualized
+  EXPECT_LE(maxMarkerNumShort, 11u);
+  EXPECT_LE(maxMarkerNumLong, static_cast<size_t>(maxWaypointMarkerNum) + 1);
+}
+
+TEST(TestManipManager, BoundedFootstepFollowingWork)
+{
+  auto & ctl = controller();
+  double startTime = ctl.t();
+
+  // Run the update with the footsteps following the object, and record the maximum work in one control cycle, i.e.,
+  // the numbers of the knots of the object pose functions and the waypoints visited to build them
+  auto runUpdate = [&](int waypointNum) {
+    ctl.setTime(startTime);
+    auto manipManager = makeManipManager();
+    appendWaypoints(*manipManager, waypointNum);
+    manipManager->requireFootstepFollowingObj();
+
+    size_t maxWork = 0;
+    for(int i = 0; i < static_cast<int>(10.0 / dt); i++)
+    {
+      ctl.setTime(ctl.t() + dt);
+      ctl.footManager_->update();
+      manipManager->update();
+      maxWork = std::max(maxWork, manipManager->objPoseKnotNum() + manipManager->footstepObjPoseKnotNum()
+                                      + manipManager->waypointVisitNum());
+    }
+    EXPECT_FALSE(ctl.footManager_->footstepQueue().empty());
+
+    ctl.footManager_->clearFootstepQueue();
+    ctl.setTime(startTime);
+    return maxWork;
+  };
+
+  // The footsteps are generated only within the first 100 waypoints, so the work must not depend on the queue length
+  size_t maxWorkShort = runUpdate(100);
+  size_t maxWorkLong = runUpdate(10000);
+  EXPECT_EQ(maxWorkLong, maxWorkShort);
+  EXPECT_LT(maxWorkLong, 100u);
+}
+
+TEST(TestManipManager, FootstepGenClampDeltaTrans)
+{
+  auto & ctl = controller();
+  auto manipManager = makeManipManager();
+  appendWaypoints(*manipManager, 1);
+
+  // The footsteps planned in the background thread must be clamped in the same way as those checked by FootManager
+  ManipManager::FootstepGenState footstepGenState;
+  ASSERT_TRUE(manipManager->initFootstepGenState(footstepGenState));
+  const Eigen::Vector3d & deltaTransLimit = ctl.footManager_->config().deltaTransLimit;
+  constexpr int sampleNum = 10;
+  for(const auto & foot : Feet::Both)
+  {
+    for(int ix = -sampleNum; ix <= sampleNum; ix++)
+    {
+      for(int iy = -sampleNum; iy <= sampleNum; iy++)
+      {
+        for(int itheta = -sampleNum; itheta <= sampleNum; itheta++)
+        {
+          // Sample the range of 1.5 times the limit so that the inside and outside of the limit are both covered
+          Eigen::Vector3d deltaTrans =
+              1.5 / sampleNum * Eigen::Vector3d(ix, iy, itheta).cwiseProduct(deltaTransLimit);
+          Eigen::Vector3d deltaTransClamped = footstepGenState.config.clampDeltaTrans(deltaTrans, foot);
+          EXPECT_LT((deltaTransClamped - ctl.footManager_->clampDeltaTrans(deltaTrans, foot)).norm(), 1e-10)
+              << "foot: " << std::to_string(foot) << ", deltaTrans: " << deltaTrans.transpose();
+        }
+      }
+    }
+  }
+}
+
+TEST(TestManipManager, UnstampedObjPose)
+{
+  auto & ctl = controller();
+  auto manipManager = makeManipManager();
+
+  // Each unstamped message is applied to the real object
+  for(double x : {1.0, 2.0, 3.0})
+  {
+    manipManager->writeObjPose(0.0, Eigen::Vector3d(x, 0.0, 0.0));
+    manipManager->updateRealObj();
+    EXPECT_DOUBLE_EQ(ctl.realObj().posW().translation().x(), x);
+  }
+}
+
+TEST(TestManipManager, BackwardObjPoseStamp)
+{
+  auto & ctl = controller();
+  mc_rtc::Configuration mcRtcConfigOverride;
+  mcRtcConfigOverride.add("objLatencyCompensation", false);
+  auto manipManager = makeManipManager(mcRtcConfigOverride);
+
+  manipManager->writeObjPose(100.0, Eigen::Vector3d(1.0, 0.0, 0.0));
+  manipManager->updateRealObj();
+  EXPECT_DOUBLE_EQ(ctl.realObj().posW().translation().x(), 1.0);
+
+  // The history is restarted by the message whose time stamp goes backward
+  manipManager->writeObjPose(50.0, Eigen::Vector3d(2.0, 0.0, 0.0));
+  manipManager->updateRealObj();
+  EXPECT_DOUBLE_EQ(ctl.realObj().posW().translation().x(), 2.0);
+
+  manipManager->writeObjPose(50.0 + dt, Eigen::Vector3d(3.0, 0.0, 0.0));
+  manipManager->updateRealObj();
+  EXPECT_DOUBLE_EQ(ctl.realObj().posW().translation().x(), 3.0);
+}
+
+TEST(TestManipManager, ContinuousObjPoseInVelMode)
+{
+  auto & ctl = controller();
+  double startTime = ctl.t();
+
+  // Update the front footstep online, with long double support phases in which the object has started to move toward
+  // the waypoint of the front footstep while the footstep is updated
+  auto origFootManager = ctl.footManager_;
+  mc_rtc::Configuration footManagerConfig;
+  footManagerConfig.load(ctl.config()("FootManager"));
+  footManagerConfig.add("doubleSupportRatio", 0.5);
+  footManagerConfig("VelMode").add("enableOnlineFootstepUpdate", true);
+  ctl.footManager_ = std::make_shared<BWC::FootManager>(&ctl, footManagerConfig);
+  ctl.footManager_->reset();
+
+  auto manipManager = makeManipManager();
+  manipManager->startManipPhase(ManipPhaseLabel::Hold);
+  ASSERT_TRUE(manipManager->startVelMode());
+
+  // Switch the target velocity in the middle of the footsteps, and check that the reference object pose does not jump
+  constexpr double maxPosChange = 0.005; // [m]
+  constexpr double maxRotChange = 0.01; // [rad]
+  sva::PTransformd lastObjPose = manipManager->refSnapshot().objPoseWithoutOffset;
+  for(int i = 0; i < static_cast<int>(5.0 / dt); i++)
+  {
+    if(i % static_cast<int>(0.1 / dt) == 0)
+    {
+      bool fast = (i / static_cast<int>(0.1 / dt)) % 2 == 0;
+      manipManager->setRelativeVel(fast ? Eigen::Vector3d(0.25, 0.0, 0.2) : Eigen::Vector3d::Zero());
+    }
+    ctl.setTime(ctl.t() + dt);
+    ctl.footManager_->update();
+    manipManager->update();
+
+    const sva::PTransformd & objPose = manipManager->refSnapshot().objPoseWithoutOffset;
+    sva::MotionVecd objPoseChange = sva::transformError(lastObjPose, objPose);
+    EXPECT_LT(objPoseChange.linear().norm(), maxPosChange) << "time: " << ctl.t();
+    EXPECT_LT(objPoseChange.angular().norm(), maxRotChange) << "time: " << ctl.t();
+    lastObjPose = objPose;
+  }
+
+  manipManager->endVelMode();
+  ctl.footManager_ = origFootManager;
+  ctl.setTime(startTime);
+}
+
+int main(int argc, char ** argv)
+{
+  // ManipManager creates a ROS node handle
+  ros::init(argc, argv, "test_manip_manager", ros::init_options::NoSigintHandler | ros::init_options::NoRosout);
+
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}